@@ -86,6 +86,17 @@ in non-fluent variant of primary progressive aphasia. Brain, 139(10), 2778–279
 #define COMPREHENSION 1
 #define REPETITION 2
 
+#define N_LEVELs 3 /* levels at which competitors are tracked */
+#define CONCEPT_LEVEL 0
+#define LEMMA_LEVEL 1
+#define SYLLABLE_LEVEL 2
+
+#define N_ERROR_TYPEs 4 /* Semantic, Phonological, Mixed, Unrelated */
+#define SEMANTIC_ERROR 0
+#define PHONOLOGICAL_ERROR 1
+#define MIXED_ERROR 2
+#define UNRELATED_ERROR 3
+
 #define N_ASSESSMENTs 6
 #define ENGLISH 0
 #define DUTCH 1
@@ -111,6 +122,8 @@ in non-fluent variant of primary progressive aphasia. Brain, 139(10), 2778–279
 #define sKAT 11 /* target */
 #define sMAT 14 /* relative  */
 
+#define N_MAX_LEVEL_NODEs N_SYLLABLEs /* largest of N_CONCEPTs, N_LEMMAs, N_SYLLABLEs */
+
 
 
  /* connections conceptual stratum */
@@ -432,6 +445,11 @@ double DECAY_value[N_lesion_values];
  int DECAY_LESION = 0;
 
  int SHOW_RESULTS_ALL_VALUES = 0; /* set here whether to print all values */
+
+ int SHOW_ERROR_TYPES = 0; /* set here whether to print competitor sets and 
+                              error-type distributions */
+
+ int TARGET_WORD = CAT; /* concept whose competitors are derived from the network */
  
 
 /* Aphasia parameters */
@@ -501,6 +519,20 @@ double MEAN_ACT_ST[N_lesion_values][N_GROUPs][N_TASKs];
 double TOTAL_ACT_SR[N_lesion_values][N_GROUPs][N_TASKs];
 double MEAN_ACT_SR[N_lesion_values][N_GROUPs][N_TASKs];
 
+
+/* Competitor sets derived from the connections, see derive_competitor_sets() */
+int TARGET_NODE[N_LEVELs];
+int N_COMPETITORs[N_LEVELs][N_ERROR_TYPEs];
+double COMPETITOR_MASK[N_LEVELs][N_ERROR_TYPEs][N_MAX_LEVEL_NODEs]; /* 1.0 if member */
+
+/* Summed activation of each competitor set, accumulated while running */
+double TOTAL_ACT_TYPE[N_lesion_values][N_GROUPs][N_TASKs][N_LEVELs][N_ERROR_TYPEs];
+double MEAN_ACT_TYPE[N_lesion_values][N_GROUPs][N_TASKs][N_LEVELs][N_ERROR_TYPEs];
+
+/* Level at which the response of each task is scored */
+int RESPONSE_LEVEL[N_TASKs] = { SYLLABLE_LEVEL, CONCEPT_LEVEL, SYLLABLE_LEVEL };
+
+
 void set_real_data_matrix();
 void reset_network();
 void update_network();
@@ -515,6 +547,9 @@ void compute_fits_and_print_results_on_screen();
 void set_aphasic_parameters();
 void compute_activation_results();
 void determine_activation_critical_nodes();
+void derive_competitor_sets();
+void print_competitor_sets();
+void print_error_type_distribution(int a);
 
 
 /*****************
@@ -530,6 +565,11 @@ int main()
 
 	print_parameters();
 
+	derive_competitor_sets();
+
+	if (SHOW_ERROR_TYPES)
+		print_competitor_sets();
+
 	set_spreading_rates();
 
 	
@@ -957,9 +997,176 @@ void determine_activation_critical_nodes()
 	ACT_ST[lesion_value][step][group][task] = S_node_act[sKAT];
 	ACT_SR[lesion_value][step][group][task] = S_node_act[sMAT];
 
+	/* all competitor sets in one pass: masked sums over each level */
+	{
+	  int level, type, i, n;
+	  double *act;
+	  double sum;
+
+	  for (level = 0; level < N_LEVELs; level++) {
+
+		  if (level == CONCEPT_LEVEL) {
+			  act = C_node_act;
+			  n = N_CONCEPTs;
+		  }
+		  else if (level == LEMMA_LEVEL) {
+			  act = L_node_act;
+			  n = N_LEMMAs;
+		  }
+		  else {
+			  act = S_node_act;
+			  n = N_SYLLABLEs;
+		  }
+
+		  for (type = 0; type < N_ERROR_TYPEs; type++) {
+			  if (step == 0)
+				  TOTAL_ACT_TYPE[lesion_value][group][task][level][type] = 0.0;
+
+			  for (i = 0, sum = 0.0; i < n; i++)
+				  sum += COMPETITOR_MASK[level][type][i] * act[i];
+
+			  TOTAL_ACT_TYPE[lesion_value][group][task][level][type] += sum;
+		  }
+	  }
+	}
+
 }
 
 
+/* 
+   Derives the competitors of TARGET_WORD from the connections.
+   A word is semantically related if its concept is linked to the target
+   concept, phonologically related if its morpheme shares an output phoneme 
+   with the target morpheme, mixed if both, and unrelated otherwise. 
+   Lemmas inherit the relation of their concept. The target syllable is the 
+   largest syllable made up of target phonemes only; other syllables are 
+   phonologically related if they share a phoneme with the target and 
+   semantically related if they are part of a semantically related word.
+*/
+
+void derive_competitor_sets()
+{
+	int word_lemma[N_CONCEPTs], word_morpheme[N_CONCEPTs];
+	int target_phoneme[N_PHONEMEs];
+	int word_type[N_CONCEPTs];
+	int i, j, k, level, type, semantic, phonological, size, best_size;
+
+	for (level = 0; level < N_LEVELs; level++)
+		for (type = 0; type < N_ERROR_TYPEs; type++) {
+			N_COMPETITORs[level][type] = 0;
+			for (i = 0; i < N_MAX_LEVEL_NODEs; i++)
+				COMPETITOR_MASK[level][type][i] = 0.0;
+		}
+
+	/* lemma and morpheme of each concept */
+	for (i = 0; i < N_CONCEPTs; i++) {
+		word_lemma[i] = -1;
+		word_morpheme[i] = -1;
+		for (j = 0; j < N_LEMMAs; j++)
+			if (CL_con[i][j] != 0.0)
+				word_lemma[i] = j;
+		if (word_lemma[i] >= 0)
+			for (j = 0; j < N_MORPHEMEs; j++)
+				if (LM_con[word_lemma[i]][j] != 0.0)
+					word_morpheme[i] = j;
+	}
+
+	for (k = 0; k < N_PHONEMEs; k++)
+		target_phoneme[k] = (word_morpheme[TARGET_WORD] >= 0
+			&& MP_con[word_morpheme[TARGET_WORD]][k] != 0.0);
+
+	/* relation of each word to the target */
+	for (i = 0; i < N_CONCEPTs; i++) {
+		if (i == TARGET_WORD) {
+			word_type[i] = -1;
+			continue;
+		}
+
+		semantic = (CC_con[TARGET_WORD][i] != 0.0 || CC_con[i][TARGET_WORD] != 0.0);
+
+		phonological = 0;
+		if (word_morpheme[i] >= 0)
+			for (k = 0; k < N_PHONEMEs; k++)
+				if (target_phoneme[k] && MP_con[word_morpheme[i]][k] != 0.0)
+					phonological = 1;
+
+		if (semantic && phonological)
+			word_type[i] = MIXED_ERROR;
+		else if (semantic)
+			word_type[i] = SEMANTIC_ERROR;
+		else if (phonological)
+			word_type[i] = PHONOLOGICAL_ERROR;
+		else
+			word_type[i] = UNRELATED_ERROR;
+	}
+
+	TARGET_NODE[CONCEPT_LEVEL] = TARGET_WORD;
+	TARGET_NODE[LEMMA_LEVEL] = word_lemma[TARGET_WORD];
+
+	for (i = 0; i < N_CONCEPTs; i++)
+		if (word_type[i] >= 0) {
+			COMPETITOR_MASK[CONCEPT_LEVEL][word_type[i]][i] = 1.0;
+			N_COMPETITORs[CONCEPT_LEVEL][word_type[i]]++;
+
+			if (word_lemma[i] >= 0) {
+				COMPETITOR_MASK[LEMMA_LEVEL][word_type[i]][word_lemma[i]] = 1.0;
+				N_COMPETITORs[LEMMA_LEVEL][word_type[i]]++;
+			}
+		}
+
+	/* target syllable */
+	TARGET_NODE[SYLLABLE_LEVEL] = -1;
+	for (j = 0, best_size = 0; j < N_SYLLABLEs; j++) {
+		for (k = 0, size = 0; k < N_PHONEMEs; k++)
+			if (PS_con[k][j] != 0.0) {
+				if (!target_phoneme[k])
+					break;
+				size++;
+			}
+		if (k == N_PHONEMEs && size > best_size) {
+			best_size = size;
+			TARGET_NODE[SYLLABLE_LEVEL] = j;
+		}
+	}
+
+	/* relation of each other syllable to the target */
+	for (j = 0; j < N_SYLLABLEs; j++) {
+		if (j == TARGET_NODE[SYLLABLE_LEVEL])
+			continue;
+
+		phonological = 0;
+		for (k = 0; k < N_PHONEMEs; k++)
+			if (PS_con[k][j] != 0.0 && target_phoneme[k])
+				phonological = 1;
+
+		semantic = 0;
+		for (i = 0; i < N_CONCEPTs; i++)
+			if ((word_type[i] == SEMANTIC_ERROR || word_type[i] == MIXED_ERROR) 
+				&& word_morpheme[i] >= 0) {
+				for (k = 0; k < N_PHONEMEs; k++)
+					if (PS_con[k][j] != 0.0 && MP_con[word_morpheme[i]][k] == 0.0)
+						break;
+				if (k == N_PHONEMEs)
+					semantic = 1;
+			}
+
+		if (semantic && phonological)
+			type = MIXED_ERROR;
+		else if (semantic)
+			type = SEMANTIC_ERROR;
+		else if (phonological)
+			type = PHONOLOGICAL_ERROR;
+		else
+			type = UNRELATED_ERROR;
+
+		COMPETITOR_MASK[SYLLABLE_LEVEL][type][j] = 1.0;
+		N_COMPETITORs[SYLLABLE_LEVEL][type]++;
+	}
+
+}
+
+
+
 void compute_activation_results()
 {
 
@@ -1028,6 +1235,10 @@ void compute_activation_results()
 		   = (TOTAL_ACT_ST[lesion_value][group][task] / N_STEPs);
 	     MEAN_ACT_SR[lesion_value][group][task] 
 		   = (TOTAL_ACT_SR[lesion_value][group][task] / N_STEPs);
+
+	     for (i = 0; i < N_LEVELs * N_ERROR_TYPEs; i++)
+		   MEAN_ACT_TYPE[lesion_value][group][task][i / N_ERROR_TYPEs][i % N_ERROR_TYPEs]
+		     = (TOTAL_ACT_TYPE[lesion_value][group][task][i / N_ERROR_TYPEs][i % N_ERROR_TYPEs] / N_STEPs);
   
 	   }
 }
@@ -1192,11 +1403,73 @@ void compute_activation_results()
 				/ (MEAN_ACT_ST[a][NORMAL][REPETITION]
 					- MEAN_ACT_SR[a][NORMAL][REPETITION]) * 100.0);
 
+		if (SHOW_ERROR_TYPES)
+			print_error_type_distribution(a);
 
    }
  }
 
 
+ void print_competitor_sets()
+ {
+	 char *level_name[N_LEVELs] = { "Concepts ", "Lemmas   ", "Syllables" };
+	 char *type_name[N_ERROR_TYPEs] = { "semantic", "phonological", "mixed", "unrelated" };
+	 int level, type, i;
+
+	 printf("\nCompetitors of target word %d derived from the network:\n", TARGET_WORD);
+
+	 for (level = 0; level < N_LEVELs; level++) {
+		 printf("%s  target %2d ", level_name[level], TARGET_NODE[level]);
+		 for (type = 0; type < N_ERROR_TYPEs; type++) {
+			 printf("  %s {", type_name[type]);
+			 for (i = 0; i < N_MAX_LEVEL_NODEs; i++)
+				 if (COMPETITOR_MASK[level][type][i] != 0.0)
+					 printf(" %d", i);
+			 printf(" }");
+		 }
+		 printf("\n");
+	 }
+ }
+
+
+ /* Error-type distribution at the response level of each task, for the best
+    fitting lesion value a: share of the competitor activation per type */
+
+ void print_error_type_distribution(int a)
+ {
+	 double mass[N_ERROR_TYPEs], total;
+	 int type;
+
+	 printf("Errors: Semantic  Phonological  Mixed  Unrelated [%%]\n");
+
+	 for (task = 0; task < N_TASKs; task++) {
+
+		 for (type = 0, total = 0.0; type < N_ERROR_TYPEs; type++) {
+			 mass[type] = MEAN_ACT_TYPE[a][group][task][RESPONSE_LEVEL[task]][type];
+			 if (mass[type] < 0.0)
+				 mass[type] = 0.0;
+			 total += mass[type];
+		 }
+
+		 if (task == NAMING)
+			 printf("  Nam: ");
+		 else if (task == COMPREHENSION)
+			 printf("  Com: ");
+		 else
+			 printf("  Rep: ");
+
+		 for (type = 0; type < N_ERROR_TYPEs; type++)
+			 printf("  %6.2f   ", total > 0.0 ? mass[type] / total * 100.0 : 0.0);
+		 printf("\n");
+	 }
+ }
+
+
+
+
+ 
+
+
 
 
  
\ No newline at end of file
@@ -53,36 +53,92 @@ Rosen, H. J., Henry, R. G., Rabinovici, G. D., Miller, B. L., Seeley, W. W.,
 & Gorno-Tempini, M. L. (2016). Healthy brain connectivity predicts atrophy progression 
 in non-fluent variant of primary progressive aphasia. Brain, 139(10), 27782791.
 
+Further data used in the global fit of the rates (FIT_RATES), from the 
+cluster and case-series simulations:
+
+Leyton, C. E., Hodges, J. R., McLean, C. A., Kril, J. J., Piguet, O., 
+& Ballard, K. J. (2015). Is the logopenic-variant of primary progressive
+aphasia a unitary disorder? Cortex, 67, 122133.
+
+Savage, S. A., Piguet, O., & Hodges, J. R. (2014). Giving words new life: 
+Generalization of word retraining outcomes in semantic dementia. Journal 
+of Alzheimer's Disease, 40(2), 309317.
+
+Gorno-Tempini, M. L., Brambati, S. M., Ginex, V., Ogar, J., Dronkers, N. F., 
+Marcone, A., Perani, D., Garibotto, V., Cappa, S. F., & Miller, B. L. (2008). 
+The logopenic/phonological variant of primary progressive aphasia. Neurology, 
+71(16), 12271234.
+
+Individual cases of Janssen et al. (2022), see above.
+
 */
 
 
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L /* shm_open, ftruncate and nanosleep under -std=c11 as well */
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <float.h>
 #include <math.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef _WIN32
+#include <malloc.h> /* _aligned_malloc */
+#endif
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#if !defined(_WIN32) && !defined(__STDC_NO_ATOMICS__)
+#define RESULT_THREAD /* a background writer drains the result queue, see RESULT QUEUE */
+#define LIVE_SHM /* the live stream is a shared-memory ring, see LIVE STREAM */
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#endif
 
 
 #define STEP_SIZE 25   /* duration time step in ms */
-#define N_STEPs 80     /* 2000 ms in total */
 #define N_CONCEPTs 5   
 #define N_LEMMAs 5     
 #define N_MORPHEMEs 5  
 #define N_PHONEMEs 10   
 #define N_SYLLABLEs 5  
 
-#define N_lesion_values 100 /* for 100 for weight lesion, 66 (!) for decay lesion */
-
 #define N_GROUPs 4 /* Normal, Nonfluent_agrammatic, Semantic_dementia, Logopenic */
 #define NORMAL 0
 #define NONFLUENT_AGRAMMATIC 1
 #define SEMANTIC_DEMENTIA 2
 #define LOGOPENIC 3
 
+#define N_SITEs 7 /* lesion sites: those of the groups, and the logopenic clusters of Leyton et al. */
+#define LEYTON_CLUSTER_1 4
+#define LEYTON_CLUSTER_2 5
+#define LEYTON_CLUSTER_3 6
+
 #define N_TASKs 3 /* Naming, Comprehension, Repetition */
 #define NAMING 0
 #define COMPREHENSION 1
 #define REPETITION 2
 
+#define N_LEVELs 3 /* levels at which competitors are tracked */
+#define CONCEPT_LEVEL 0
+#define LEMMA_LEVEL 1
+#define SYLLABLE_LEVEL 2
+
+#define N_ERROR_TYPEs 4 /* Semantic, Phonological, Mixed, Unrelated */
+#define SEMANTIC_ERROR 0
+#define PHONOLOGICAL_ERROR 1
+#define MIXED_ERROR 2
+#define UNRELATED_ERROR 3
+
 #define N_ASSESSMENTs 6
 #define ENGLISH 0
 #define DUTCH 1
@@ -118,6 +174,58 @@ in non-fluent variant of primary progressive aphasia. Brain, 139(10), 2778
 #define Fog 3
 #define Fish 4
 
+#define N_MAX_LEVEL_NODEs N_SYLLABLEs /* largest of N_CONCEPTs, N_LEMMAs, N_SYLLABLEs */
+
+ /* position of each layer in the state vector of the closed-form solution */
+#define OFF_C 0
+#define OFF_L (OFF_C + N_CONCEPTs)
+#define OFF_M (OFF_L + N_LEMMAs)
+#define OFF_oP (OFF_M + N_MORPHEMEs)
+#define OFF_iP (OFF_oP + N_PHONEMEs)
+#define OFF_iM (OFF_iP + N_PHONEMEs)
+#define OFF_S (OFF_iM + N_MORPHEMEs)
+#define N_NODEs (OFF_S + N_SYLLABLEs)
+#define N_POWERs 16 /* A, A^2, ..., A^(2^15): trials of up to 65535 steps */
+
+#define N_LAYERs 7 /* layers that can have an increased decay */
+#define C_LAYER 0
+#define L_LAYER 1
+#define M_LAYER 2
+#define oP_LAYER 3
+#define iP_LAYER 4
+#define iM_LAYER 5
+#define S_LAYER 6
+
+#define N_BLOCKs 12 /* connection blocks that can have a decreased weight */
+#define PICTURE_BLOCK 0 /* picture to concept */
+#define CC_BLOCK 1
+#define LC_BLOCK 2
+#define CL_BLOCK 3
+#define iML_BLOCK 4
+#define LM_BLOCK 5
+#define iMM_BLOCK 6
+#define MP_BLOCK 7
+#define iPoP_BLOCK 8
+#define PS_BLOCK 9
+#define oPiP_BLOCK 10
+#define PiM_BLOCK 11
+
+#define BATCH 64 /* virtual patients simulated together, see simulate_population_batch() */
+
+#define N_PRECISIONs 3 /* of the batched simulations */
+#define DOUBLE_PRECISION 0
+#define SINGLE_PRECISION 1
+#define MIXED_PRECISION 2 /* single-precision activations and weights, double-precision sums */
+
+#define N_RATEs 7 /* parameters shared by all simulations */
+#define R_SEM 0
+#define R_LEM 1
+#define R_LEX 2
+#define R_DECAY 3
+#define R_EXTIN 4
+#define R_LEMLEXFRAC 5
+#define R_FR 6
+
 
  /* connections conceptual network */
  double  CC_con[N_CONCEPTs][N_CONCEPTs] =  {
@@ -292,32 +400,70 @@ double REAL_DATA_ROHRERMANDELLI_T2[N_GROUPs][N_TASKs] = {
 };
 
 
+/* studies in the global fit; each counts equally, whatever its number of cases */
+#define N_STUDIES 10
+char *STUDY_NAME[N_STUDIES] = {
+	"English groups", "Dutch groups", "Brambati T1", "Brambati T2",
+	"Rohrer/Mandelli T1", "Rohrer/Mandelli T2", "Leyton clusters",
+	"Savage cases", "Gorno-Tempini cases", "Janssen cases" };
+
+#define N_MAX_FIT_CASEs 80 /* of STUDY_FILE, see set_up_fit_cases() */
+ int N_FIT_CASEs;
+ int FIT_CASE_STUDY[N_MAX_FIT_CASEs];
+ int FIT_CASE_SITE[N_MAX_FIT_CASEs];
+ double *FIT_CASE_DATA[N_MAX_FIT_CASEs];
+
+
 
 double REAL_DATA[N_GROUPs][N_TASKs];
 double SIM_DATA[N_GROUPs][N_TASKs];
-double GOODNESS_OF_FIT[N_lesion_values];
+/* 
+   Sizes of a run, set in main() or on the command line (values=, steps=). 
+   The tensors that depend on them are taken from STATE_ARENA, see 
+   allocate_state(). 
+*/
+int N_lesion_values = 0; /* 0: 100 for a weight lesion, 66 for a decay lesion */
+int N_STEPs = 80;        /* 2000 ms in total */
+
+double *GOODNESS_OF_FIT;
 
 
-double WEIGHT_value[N_lesion_values];
-double DECAY_value[N_lesion_values];
+double *WEIGHT_value;
+double *DECAY_value;
 
 
-/* concept and lemma */
- double C_node_act[N_CONCEPTs], L_node_act[N_LEMMAs];
- /* output form */
- double M_node_act[N_MORPHEMEs], oP_node_act[N_PHONEMEs], S_node_act[N_SYLLABLEs];
- /* input form */
- double iM_node_act[N_MORPHEMEs], iP_node_act[N_PHONEMEs];
+/* activation, or input, of the nodes of each layer */
+typedef struct {
+	/* concept and lemma */
+	double C[N_CONCEPTs], L[N_LEMMAs];
+	/* output form */
+	double M[N_MORPHEMEs], oP[N_PHONEMEs], S[N_SYLLABLEs];
+	/* input form */
+	double iM[N_MORPHEMEs], iP[N_PHONEMEs];
+} LAYERS;
 
+ LAYERS node_act; /* activation of the nodes in the current trial */
 
- /* input buffer for nodes */
- double input_C[N_CONCEPTs];
- double input_L[N_LEMMAs];
- double input_M[N_MORPHEMEs];
- double input_iM[N_MORPHEMEs];
- double input_iP[N_PHONEMEs];
- double input_oP[N_PHONEMEs];
- double input_S[N_SYLLABLEs];
+/* the same for a batch of networks, with the batch as the innermost index */
+typedef struct {
+	double C[N_CONCEPTs][BATCH], L[N_LEMMAs][BATCH];
+	double M[N_MORPHEMEs][BATCH], oP[N_PHONEMEs][BATCH], S[N_SYLLABLEs][BATCH];
+	double iM[N_MORPHEMEs][BATCH], iP[N_PHONEMEs][BATCH];
+} BATCH_LAYERS;
+
+/* the same, and the weights of a weight set, in single precision */
+typedef struct {
+	float C[N_CONCEPTs][BATCH], L[N_LEMMAs][BATCH];
+	float M[N_MORPHEMEs][BATCH], oP[N_PHONEMEs][BATCH], S[N_SYLLABLEs][BATCH];
+	float iM[N_MORPHEMEs][BATCH], iP[N_PHONEMEs][BATCH];
+} FLOAT_BATCH_LAYERS;
+
+typedef struct {
+	float CC[N_CONCEPTs][N_CONCEPTs], LC[N_CONCEPTs][N_LEMMAs], CL[N_LEMMAs][N_CONCEPTs];
+	float iML[N_LEMMAs][N_MORPHEMEs], LM[N_MORPHEMEs][N_LEMMAs], iMM[N_MORPHEMEs][N_MORPHEMEs];
+	float MP[N_PHONEMEs][N_MORPHEMEs], iPoP[N_PHONEMEs][N_PHONEMEs], PS[N_SYLLABLEs][N_PHONEMEs];
+	float oPiP[N_PHONEMEs][N_PHONEMEs], PiM[N_MORPHEMEs][N_PHONEMEs];
+} FLOAT_WEIGHT_SET;
 
 
  int T, step;     /* time in ms, step */
@@ -345,6 +491,104 @@ double DECAY_value[N_lesion_values];
  int DECAY_LESION = 0;
 
  int SHOW_RESULTS_ALL_VALUES = 0; /* set here whether to print all values */
+
+ int SHOW_ERROR_TYPES = 0; /* set here whether to print competitor sets and 
+                              error-type distributions */
+
+ int TARGET_WORD = CAT; /* concept whose competitors are derived from the network */
+
+ int SHOW_LUCE_RESULTS = 0; /* set here whether to compute and print Luce-ratio accuracy and latency */
+
+ int SHOW_SENSITIVITIES = 0; /* set here whether to compute and print d(score)/d(parameter) */
+
+ int BOOTSTRAP = 0; /* set here whether to print bootstrap intervals of the best-fit lesion values */
+ int N_BOOTSTRAP_SAMPLEs = 10000;
+ double BOOTSTRAP_LEVEL = 0.95; /* coverage of the percentile interval */
+ int N_ITEMs = 30; /* items per task in the Sydney Language Battery */
+
+ int POPULATION = 0; /* set here whether to simulate virtual patient populations first */
+ long N_VIRTUAL_PATIENTs = 1000000; /* per variant */
+ int SAVE_PATIENTS = 0; /* set here to write every virtual patient to PATIENT_FILE, see RESULT QUEUE */
+ char PATIENT_FILE[] = "wpparc virtual patients.csv";
+
+ /* lesion distributions of the virtual populations: the lesion value of 
+    the variant's own site is normal (clipped to the lesion range), and 
+    each other site gets a mixed-in lesion of |normal(0, POP_MIX_SD)| */
+ double POP_MEAN[N_GROUPs]   = { 1.0, 0.93, 0.80, 0.86 }; /* weight lesion values */
+ double POP_SD[N_GROUPs]     = { 0.0, 0.04, 0.10, 0.05 };
+ double POP_MIX_SD[N_GROUPs] = { 0.0, 0.03, 0.03, 0.03 };
+
+ int PROGRESSION = 0; /* set here whether to fit baseline and follow up jointly */
+ double FOLLOW_UP_YEARS[N_ASSESSMENTs] = { 0.0, 0.0, 0.0, 1.0, 0.0, 1.0 }; /* since baseline */
+ int N_PROJECTED_YEARs = 3; /* projected visits after the follow up */
+
+ int LOOKUP_FITS = 0; /* set here to only fit from the precomputed lesion-score table */
+ char LOOKUP_TABLE_FILE[] = "wpparc lesion scores.tab"; /* built when missing or stale */
+
+ int CLASSIFY_CASES = 0; /* set here to classify the individual cases by their nearest profiles */
+ int K_NEAREST = 5;
+
+ int SERVE = 0; /* set here to run as a fitting service on stdin and stdout, see serve() */
+ double SERVICE_NOISE = 5.0; /* scale of the Laplace noise on a score, for the variant likelihoods */
+
+ int REGISTRY_FITS = 0; /* set here to fit every patient of REGISTRY_FILE from the lookup table */
+ char REGISTRY_FILE[] = "wpparc registry.csv"; /* rows: ID, variant, naming, comprehension, repetition */
+ char REGISTRY_FITS_FILE[] = "wpparc registry fits.csv";
+
+ int GRID_SWEEP = 0; /* set here to sweep all lesion combinations of the three sites first */
+ int GRID_DECAY = 0; /* set here to sweep the decay instead of the weight factors */
+ int GRID_ASSESSMENT = ENGLISH; /* data of the MAEs */
+ char GRID_FILE[] = "wpparc lesion grid.bin";
+
+ int PRECISION = DOUBLE_PRECISION; /* set here to SINGLE_PRECISION or MIXED_PRECISION for the 
+                                      batched simulations (populations, grid), see PRECISION */
+ int PRECISION_REPORT = 0; /* set here to compare the precisions with the double-precision trials first */
+
+ int SHOW_TRAJECTORY_METRICS = 0; /* set here to print time-course metrics at the best fit */
+ int WINDOW_START = 0;   /* ms, the windowed mean is over (WINDOW_START, WINDOW_END] */
+ int WINDOW_END = 2000;
+
+ int SAVE_PREFIX_SUMS = 0; /* set here to save the prefix sums of the trajectories, see save_prefix_sums() */
+ int QUERY_PREFIX_SUMS = 0; /* set here to answer time-window queries on stdin from the saved file */
+ int PREFIX_ASSESSMENT = ENGLISH; /* data the queried windows are fitted to */
+ char PREFIX_FILE[] = "wpparc trajectories.psum";
+
+ char *PROBE_SPEC = ""; /* set here, or with probes=, to record further nodes, e.g. "C.FISH iP:4", 
+                           see parse_probes() */
+ char PROBE_FILE[] = "wpparc probes.csv";
+
+ int LIVE_STREAM = 0; /* set here to publish the probes of every step to LIVE_STREAM_NAME, 
+                         watch with "<program> watch" */
+ char LIVE_STREAM_NAME[] = "/wpparc_live";
+
+ int RUN_STUDIES = 0; /* set here, or with studies=, to run all studies of STUDY_FILE instead */
+ char *STUDY_FILE = "wpparc studies.def";
+
+ int WRITE_KERNEL = 0; /* set here, or with kernel, to write the unrolled get_internal_input() 
+                          of the network to KERNEL_FILE, see NETWORK KERNEL */
+ char KERNEL_FILE[] = "wpparc kernel.h";
+ int KERNEL_FITS = 0; /* whether the network is that of the compiled kernel */
+
+ /* activation a node needs before it can be selected, per level */
+ double SELECTION_THRESHOLD[N_LEVELs] = { 0.1, 0.1, 0.5 }; /* act_units */
+
+ int MEAN_ONLY = 0; /* set here to compute the mean activations in closed form, 
+                       without time stepping (no Luce-ratio results) */
+
+ int EXPONENTIAL_INTEGRATION = 0; /* set here to step the network exactly, see EXPONENTIAL INTEGRATION */
+
+ int FIT_RATES = 0; /* set here to fit the shared rates to all studies first */
+ int FIT_MAX_ITERATIONs = 60;
+ double FIT_INITIAL_STEP = 0.2; /* relative change of a rate, halved when nothing improves */
+ double FIT_MIN_STEP = 0.01;
+
+ int EARLY_TERMINATION = 0; /* set here to stop spreading once activation has died out */
+ double TERMINATION_TOLERANCE = 0.001; /* summed activation relative to its peak */
+
+ /* system matrix, factored (I-A) and squares of A of the last closed-form trial */
+ double CF_A[N_NODEs][N_NODEs], CF_G[N_NODEs][N_NODEs];
+ double CF_P[N_POWERs][N_NODEs][N_NODEs];
+ int CF_pivot[N_NODEs], CF_valid = 0, CF_ok = 0;
  
 
 /* Aphasia parameters */
@@ -373,116 +617,633 @@ double DECAY_value[N_lesion_values];
  /* lexical output forms */
 
 
+/* 
+   Effective weights. The *_con matrices above only hold the topology and 
+   are never changed. A weight set holds, for one configuration of rates 
+   and lesion factors, the weights with rates and lesions applied, stored 
+   [to][from], and the proportion of activation each layer retains per step. 
+   Weight sets are derived once per configuration and kept in a cache.
+*/
+
+typedef struct {
+	double rate[N_RATEs];
+	double weight_factor[N_BLOCKs]; /* product of the connection decreases of all lesioned sites */
+	double decay_factor[N_LAYERs];  /* product of the decay increases of all lesioned sites */
+} WEIGHT_CONFIGURATION;
+
+/* with EXPONENTIAL_INTEGRATION, the step x <- PHI x + GAMMA e of the node vector */
+typedef struct {
+	double PHI[N_NODEs][N_NODEs], GAMMA[N_NODEs][N_NODEs];
+} PROPAGATOR;
+
+typedef struct {
+	WEIGHT_CONFIGURATION config;
+
+	double picture_input, extin;         /* external input per step */
+	double CC[N_CONCEPTs][N_CONCEPTs];   /* concept to concept */
+	double LC[N_CONCEPTs][N_LEMMAs];     /* lemma to concept */
+	double CL[N_LEMMAs][N_CONCEPTs];     /* concept to lemma */
+	double iML[N_LEMMAs][N_MORPHEMEs];   /* input morpheme to lemma */
+	double LM[N_MORPHEMEs][N_LEMMAs];    /* lemma to output morpheme */
+	double iMM[N_MORPHEMEs][N_MORPHEMEs]; /* input to output morpheme */
+	double MP[N_PHONEMEs][N_MORPHEMEs];  /* output morpheme to output phoneme */
+	double iPoP[N_PHONEMEs][N_PHONEMEs]; /* input to output phoneme */
+	double PS[N_SYLLABLEs][N_PHONEMEs];  /* output phoneme to syllable */
+	double oPiP[N_PHONEMEs][N_PHONEMEs]; /* output to input phoneme */
+	double PiM[N_MORPHEMEs][N_PHONEMEs]; /* input phoneme to input morpheme */
+
+	/* 1 - decay, per layer */
+	double keep_C, keep_L, keep_M, keep_oP, keep_iP, keep_iM, keep_S;
+
+	/* with EXPONENTIAL_INTEGRATION only, else NULL; after the doubles, see derive_propagator() */
+	const PROPAGATOR *propagator;
+} WEIGHT_SET;
+
+#define N_WEIGHT_SETs 512 /* cached configurations, more than N_GROUPs * 100 lesion values */
+
+ WEIGHT_SET WEIGHT_CACHE[N_WEIGHT_SETs];
+ int N_CACHED_WEIGHT_SETs = 0;  /* number of configurations derived so far */
+ WEIGHT_SET *W;                 /* weight set of the current trial */
+ PROPAGATOR *PROPAGATOR_CACHE;  /* [N_WEIGHT_SETs], of WEIGHT_CACHE, with EXPONENTIAL_INTEGRATION only */
+
+ /* the shared parameters, in the order of the R_ indices */
+ double *RATE_VARIABLE[N_RATEs] = { &SEM_rate, &LEM_rate, &LEX_rate, &DECAY_rate, 
+                                     &EXTIN, &LEMLEXFRAC, &FR };
+
+ /* connection blocks and layers affected by a lesion at each site */
+ int SITE_BLOCKS[N_SITEs][N_BLOCKs] = {
+                        /* Pic CC  LC  CL  iML LM  iMM MP  iPoP PS oPiP PiM */
+ /* Normal               */ { N,  N,  N,  N,  N,  N,  N,  N,  N,  N,  N,  N },
+ /* Nonfluent/agrammatic */ { N,  N,  N,  N,  N,  N,  N,  Y,  Y,  Y,  Y,  N },
+ /* Semantic             */ { Y,  Y,  Y,  Y,  N,  N,  N,  N,  N,  N,  N,  N },
+ /* Logopenic            */ { N,  N,  N,  N,  N,  Y,  Y,  Y,  Y,  N,  Y,  N },
+ /* Leyton cluster 1     */ { N,  N,  N,  N,  N,  Y,  Y,  Y,  Y,  N,  Y,  N },
+ /* Leyton cluster 2     */ { N,  N,  Y,  Y,  N,  Y,  Y,  Y,  N,  N,  N,  N },
+ /* Leyton cluster 3     */ { N,  N,  N,  N,  N,  Y,  Y,  Y,  Y,  N,  Y,  N }
+ };
+
+ int SITE_LAYERS[N_SITEs][N_LAYERs] = {
+                        /* C   L   M   oP  iP  iM  S  */
+ /* Normal               */ { N,  N,  N,  N,  N,  N,  N },
+ /* Nonfluent/agrammatic */ { N,  N,  N,  Y,  N,  N,  N },
+ /* Semantic             */ { Y,  N,  N,  N,  N,  N,  N },
+ /* Logopenic            */ { N,  N,  Y,  N,  N,  N,  N },
+ /* Leyton cluster 1     */ { N,  N,  Y,  Y,  N,  N,  N },
+ /* Leyton cluster 2     */ { N,  Y,  Y,  N,  N,  N,  N },
+ /* Leyton cluster 3     */ { N,  N,  Y,  Y,  N,  N,  N }
+ };
+
+#ifdef NETWORK_KERNEL
+#include "wpparc kernel.h" /* written by "<program> kernel", see NETWORK KERNEL */
+#endif
+
+
+#define N_TABLE_VALUEs 1001 /* lookup table: weight 0.000 - 1.000, decay 1.00000 - 1.66000 */
+#define N_LESION_TYPEs 2
+#define WEIGHT_TYPE 0
+#define DECAY_TYPE 1
+
+/* time-course metrics of one series, see trace_metrics() */
+typedef struct {
+	double total, window_total, auc, peak;
+	int n_window, peak_step, threshold_step; /* step -1: never */
+} TRACE_METRICS;
+
+/* block of memory handed out front to back */
+typedef struct {
+	char *base;
+	size_t size, used;
+} ARENA;
+
+/* header of the lesion-score lookup table file, followed by the scores */
+typedef struct {
+	char magic[8];
+	int n_values, n_types, n_groups, n_tasks, n_steps, step_size;
+	double rate[N_RATEs];
+	double lo[N_LESION_TYPEs], hi[N_LESION_TYPEs];
+	unsigned long long network; /* checksum of the weight sets, see network_checksum() */
+} LOOKUP_HEADER;
 
-double ACT_C[N_lesion_values][N_STEPs][N_GROUPs][N_TASKs];
-double ACT_S[N_lesion_values][N_STEPs][N_GROUPs][N_TASKs];
+typedef double LOOKUP_SCORES[N_LESION_TYPEs][N_GROUPs][N_TABLE_VALUEs][N_TASKs];
+
+/* 
+   The profile index and the lesion grid space their values like the 
+   lesion values of the run, 0.01 by default, see set_lesion_spacing() 
+*/
+double LESION_STEP;
+int N_WEIGHT_PROFILEs; /* weight values 0.00 - 0.99 by default */
+int N_DECAY_PROFILEs;  /* decay values 1.01 - 1.66 by default */
+int N_PROFILEs;        /* (N_SITEs - 1) * (N_WEIGHT_PROFILEs + N_DECAY_PROFILEs) */
+
+/* header of the multi-site lesion grid file, followed by the tiles */
+typedef struct {
+	char magic[8];
+	int n, decay, assessment, n_fields;
+	double first, step; /* lesion value of index 0, and between indices */
+} GRID_HEADER;
+
+/* header of the trajectory prefix-sum file, see save_prefix_sums() */
+typedef struct {
+	char magic[8];
+	int n_values, n_steps, step_size, n_groups, n_tasks, n_probes, weight_lesion;
+} PREFIX_HEADER;
+
+/* a further probe: nodes first to first + n - 1 of a layer, recorded every stride steps */
+typedef struct {
+	int layer, first, n, stride, n_samples;
+	size_t offset; /* of its samples in the record of a trial */
+} PROBE;
+
+/* the virtual patients of one batch, as queued for the writer */
+typedef struct {
+	int variant;
+	long batch;
+	double lesion[N_GROUPs][BATCH]; /* of the sites of the variants, NORMAL unused */
+	double score[N_TASKs][BATCH];
+} PATIENT_RECORD;
+
+/* a patient of the registry, and its fit */
+typedef struct {
+	char id[64];
+	int variant; /* -1: unknown, fitted to all variants */
+	double data[N_TASKs];
+	double value, mae;
+	const char *error; /* NULL if the row is fine */
+} REGISTRY_ROW;
+
+/* simulated scores of one lesion site, type and severity */
+typedef struct {
+	double score[N_TASKs];
+	int site, weight_lesion;
+	double value;
+} PROFILE;
+
+
+
+/* 
+   Trajectory store: the activation of each probed node in every trial, as 
+   one contiguous time series per lesion value, group, task and probe. 
+*/
+#define N_PROBEs 8
+#define PROBE_C 0  /* target concept, cat */
+#define PROBE_S 1  /* target syllable, cat */
+#define PROBE_CT 2 /* target concept, cat */
+#define PROBE_CR 3 /* conceptual relative, dog */
+#define PROBE_LT 4 /* target lemma, cat */
+#define PROBE_LR 5 /* lemma relative, i.e., semantically related, dog */
+#define PROBE_ST 6 /* target syllable, cat */
+#define PROBE_SR 7 /* syllabic relative, mat */
+
+double *TRAJECTORY; /* [lesion value][group][task][probe][step] */
+
+/* the time series of a probe in a trial */
+#define TRACE(lv, g, t, p) \
+	(&TRAJECTORY[((((size_t) (lv) * N_GROUPs + (g)) * N_TASKs + (t)) * N_PROBEs + (p)) * N_STEPs])
+
+
+#define N_LIVE_SLOTs 4096 /* samples kept in the live stream, a power of two */
+
+/* one step of one trial in the live stream */
+typedef struct {
+#ifdef LIVE_SHM
+	atomic_ullong sequence; /* sample number + 1 once complete, 0 while written */
+#else
+	unsigned long long sequence;
+#endif
+	int lesion_value, group, task, step;
+	double value; /* lesion value */
+	double act[N_PROBEs];
+} LIVE_SAMPLE;
+
+/* the shared memory of the live stream: this header, then the ring of samples */
+typedef struct {
+	char magic[8];
+	int n_slots, n_probes, step_size, sample_size;
+#ifdef LIVE_SHM
+	atomic_ullong published; /* samples published so far */
+#else
+	unsigned long long published;
+#endif
+	LIVE_SAMPLE sample[N_LIVE_SLOTs];
+} LIVE_RING;
 
-/* Activation of target concept, cat */
-double ACT_CT[N_lesion_values][N_STEPs][N_GROUPs][N_TASKs]; 
-/* Activation of conceptual relative, dog */
-double ACT_CR[N_lesion_values][N_STEPs][N_GROUPs][N_TASKs];
 
-/* Activation of target lemma, cat */
-double ACT_LT[N_lesion_values][N_STEPs][N_GROUPs][N_TASKs]; 
-/* Activation of lemma relative, i.e., semantically related, dog */
-double ACT_LR[N_lesion_values][N_STEPs][N_GROUPs][N_TASKs];
+/* 
+   Further probes, see parse_probes(). Their samples are kept in one compact 
+   buffer, PROBE_RECORD_SIZE per trial: the probes one after the other, 
+   each as [node][sample].
+*/
+#define N_MAX_EXTRA_PROBEs 32
 
-/* Activation of target syllable, cat */
-double ACT_ST[N_lesion_values][N_STEPs][N_GROUPs][N_TASKs]; 
-/* Activation of syllabic relative, mat */
-double ACT_SR[N_lesion_values][N_STEPs][N_GROUPs][N_TASKs]; 
+PROBE EXTRA_PROBE[N_MAX_EXTRA_PROBEs];
+int N_EXTRA_PROBEs = 0;
+size_t PROBE_RECORD_SIZE = 0;
+double *PROBE_RECORD; /* [lesion value][group][task][PROBE_RECORD_SIZE] */
 
 
-double TOTAL_ACT_C[N_lesion_values][N_GROUPs][N_TASKs];
-double MEAN_ACT_C[N_lesion_values][N_GROUPs][N_TASKs];
-double TOTAL_ACT_S[N_lesion_values][N_GROUPs][N_TASKs];
-double MEAN_ACT_S[N_lesion_values][N_GROUPs][N_TASKs];
+double (*TOTAL_ACT_C)[N_GROUPs][N_TASKs];
+double (*MEAN_ACT_C)[N_GROUPs][N_TASKs];
+double (*TOTAL_ACT_S)[N_GROUPs][N_TASKs];
+double (*MEAN_ACT_S)[N_GROUPs][N_TASKs];
 
 /* T = target, R = relative */
-double TOTAL_ACT_CT[N_lesion_values][N_GROUPs][N_TASKs];
-double MEAN_ACT_CT[N_lesion_values][N_GROUPs][N_TASKs];
-double TOTAL_ACT_CR[N_lesion_values][N_GROUPs][N_TASKs];
-double MEAN_ACT_CR[N_lesion_values][N_GROUPs][N_TASKs];
+double (*TOTAL_ACT_CT)[N_GROUPs][N_TASKs];
+double (*MEAN_ACT_CT)[N_GROUPs][N_TASKs];
+double (*TOTAL_ACT_CR)[N_GROUPs][N_TASKs];
+double (*MEAN_ACT_CR)[N_GROUPs][N_TASKs];
+
+double (*TOTAL_ACT_LT)[N_GROUPs][N_TASKs];
+double (*MEAN_ACT_LT)[N_GROUPs][N_TASKs];
+double (*TOTAL_ACT_LR)[N_GROUPs][N_TASKs];
+double (*MEAN_ACT_LR)[N_GROUPs][N_TASKs];
+
+double (*TOTAL_ACT_ST)[N_GROUPs][N_TASKs];
+double (*MEAN_ACT_ST)[N_GROUPs][N_TASKs];
+double (*TOTAL_ACT_SR)[N_GROUPs][N_TASKs];
+double (*MEAN_ACT_SR)[N_GROUPs][N_TASKs];
+
+
+/* Competitor sets derived from the connections, see derive_competitor_sets() */
+int TARGET_NODE[N_LEVELs];
+int N_COMPETITORs[N_LEVELs][N_ERROR_TYPEs];
+double COMPETITOR_MASK[N_LEVELs][N_ERROR_TYPEs][N_MAX_LEVEL_NODEs]; /* 1.0 if member */
+
+/* Summed activation of each competitor set, accumulated while running */
+double (*TOTAL_ACT_TYPE)[N_GROUPs][N_TASKs][N_LEVELs][N_ERROR_TYPEs];
+double (*MEAN_ACT_TYPE)[N_GROUPs][N_TASKs][N_LEVELs][N_ERROR_TYPEs];
+
+/* Level at which the response of each task is scored */
+int RESPONSE_LEVEL[N_TASKs] = { SYLLABLE_LEVEL, CONCEPT_LEVEL, SYLLABLE_LEVEL };
 
-double TOTAL_ACT_LT[N_lesion_values][N_GROUPs][N_TASKs];
-double MEAN_ACT_LT[N_lesion_values][N_GROUPs][N_TASKs];
-double TOTAL_ACT_LR[N_lesion_values][N_GROUPs][N_TASKs];
-double MEAN_ACT_LR[N_lesion_values][N_GROUPs][N_TASKs];
 
-double TOTAL_ACT_ST[N_lesion_values][N_GROUPs][N_TASKs];
-double MEAN_ACT_ST[N_lesion_values][N_GROUPs][N_TASKs];
-double TOTAL_ACT_SR[N_lesion_values][N_GROUPs][N_TASKs];
-double MEAN_ACT_SR[N_lesion_values][N_GROUPs][N_TASKs];
+/* Luce-ratio response selection, see update_response_selection() */
+double (*P_SELECT_TARGET)[N_GROUPs][N_TASKs];
+double (*P_SELECT_TYPE)[N_GROUPs][N_TASKs][N_ERROR_TYPEs];
+double (*P_NO_RESPONSE)[N_GROUPs][N_TASKs];
+double (*RESPONSE_LATENCY)[N_GROUPs][N_TASKs]; /* ms, given a response */
+
+/* running state of the current trial */
+double SURVIVAL;        /* probability that no node has been selected yet */
+double SUM_TIME_PROB;   /* sum of selection time times probability */
+
+
+/* Sensitivities: derivatives of the mean activations that enter the scores 
+   with respect to the rates and the lesion factor, see compute_sensitivities() */
+#define N_SENS_PARAMs (N_RATEs + 1)
+#define SENS_LESION N_RATEs
+
+double (*D_MEAN_ACT_CT)[N_GROUPs][N_TASKs][N_SENS_PARAMs];
+double (*D_MEAN_ACT_CR)[N_GROUPs][N_TASKs][N_SENS_PARAMs];
+double (*D_MEAN_ACT_ST)[N_GROUPs][N_TASKs][N_SENS_PARAMs];
+double (*D_MEAN_ACT_SR)[N_GROUPs][N_TASKs][N_SENS_PARAMs];
+
+/* d(weights)/dp of each entry of WEIGHT_CACHE, with SHOW_SENSITIVITIES only */
+WEIGHT_SET (*TANGENT_CACHE)[N_SENS_PARAMs]; /* [N_WEIGHT_SETs] */
+int TANGENT_GROUP[N_WEIGHT_SETs];           /* group they were derived for, -1 if none yet */
+
+/* early termination: state of the current trial */
+double PEAK_TOTAL_ACT;  /* largest summed activation so far */
+double PREV_TOTAL_ACT;  /* summed activation of the previous step */
+double TAIL_RATE;       /* contraction per step once terminated, 0.0 while spreading */
 
 void set_real_data_matrix();
 void reset_network();
 void update_network();
 void set_spreading_rates();
-void set_input_to_zero();
-void get_external_input();
-void get_internal_input();
-void update_activation_of_nodes();
+void network_step(LAYERS *act, const WEIGHT_SET *w, int task, int T);
+void get_external_input(LAYERS *input, const WEIGHT_SET *w, int task, int T);
+void get_internal_input(const LAYERS *act, LAYERS *input, const WEIGHT_SET *w);
+void update_activation_of_nodes(LAYERS *act, const LAYERS *input, const WEIGHT_SET *w);
+int stimulus_offset();
+double summed_activation();
+int check_early_termination();
+void decay_network();
+void finish_early_termination();
 void print_heading();
 void print_parameters();
 void compute_fits_and_print_results_on_screen();
 void set_aphasic_parameters();
+void get_rate_configuration(WEIGHT_CONFIGURATION *c, const double rate[N_RATEs]);
+void add_lesion(WEIGHT_CONFIGURATION *c, int site, double weight_factor, double decay_factor);
+void add_lesion_at(WEIGHT_CONFIGURATION *c, const int blocks[N_BLOCKs], const int layers[N_LAYERs], 
+	double weight_factor, double decay_factor);
+void get_weight_configuration(WEIGHT_CONFIGURATION *c);
+void derive_weight_set(WEIGHT_SET *w);
+WEIGHT_SET *get_weight_set();
 void compute_activation_results();
+void trace_metrics(const double *target, const double *relative, double threshold, TRACE_METRICS m[3]);
+void print_trajectory_metrics(int a);
+void get_prefix_header(PREFIX_HEADER *h);
+int save_prefix_sums(const char *file);
+int window_steps(int n_steps, int start, int end, int *a, int *b);
+double window_sum(const double *prefix, int n_steps, int start, int end);
+void window_scores(const double *prefix, const PREFIX_HEADER *h, int lv, int g, 
+	int start, int end, double score[N_TASKs]);
+int query_prefix_sums();
+double *layer_nodes(LAYERS *x, int layer, int *n);
+int parse_probes(const char *spec);
+void record_probes();
+int write_probes(const char *file);
 void determine_activation_critical_nodes();
+int open_live_stream();
+void publish_live_sample();
+int watch_live_stream();
+int find_name(char *name[], int n, const char *word);
+int read_study_definitions(const char *file);
+int study_cases(const char *title, const char *site, double (**data)[N_TASKs]);
+int janssen_cases(int variant, double (**data)[N_TASKs]);
+int run_studies();
+int write_network_kernel(const char *file);
+int network_fits_kernel();
+void derive_competitor_sets();
+void print_competitor_sets();
+void print_error_type_distribution(int a);
+void update_response_selection();
+void finish_response_selection();
+void print_luce_results(int a);
+void derive_weight_set_tangent(int param, WEIGHT_SET *dw);
+void derive_spread_links();
+void network_step_tangent(LAYERS *act, LAYERS dact[], int n, const WEIGHT_SET *w, 
+	const WEIGHT_SET dw[], int task, int T);
+void compute_sensitivities();
+void print_sensitivities(int a);
+void compute_score_table();
+unsigned long long next_random(unsigned long long *state);
+int best_fit_in_score_table(double data[N_TASKs]);
+void bootstrap_sample(unsigned long long *state, double data[N_TASKs]);
+void print_bootstrap_interval();
+double table_error(int lv, const double data[N_TASKs]);
+int progressed(int lv1, int lv2);
+int descend_from(int lv, const double data[N_TASKs], int *n_evaluated);
+void fit_progression(const double baseline[N_TASKs], const double follow_up[N_TASKs], 
+	int *lv1, int *lv2, int *n_evaluated);
+void interpolate_scores(double value, double score[N_TASKs]);
+void print_progression();
+unsigned long long network_checksum(const double rate[N_RATEs]);
+void get_lookup_header(LOOKUP_HEADER *h);
+int build_lookup_table(const char *file);
+char *map_file(const char *file, size_t *size);
+void unmap_file(char *data, size_t size);
+int map_lookup_table(const char *file);
+int get_lookup_table(FILE *log);
+void lookup_scores(int type, int g, double value, double score[N_TASKs]);
+double lookup_error(int type, int g, double value, const double data[N_TASKs]);
+double fit_with_lookup_table(int type, int g, const double data[N_TASKs], double *value);
+void print_lookup_fits();
+double profile_distance(const double q[N_TASKs], int p);
+int compare_on_axis(const void *a, const void *b);
+void kd_build(int lo, int hi, int depth);
+void insert_nearest(int p, double d, int k, int nearest[], double distance[], int *n);
+void kd_search(int lo, int hi, int depth, const double q[N_TASKs], int k, 
+	int nearest[], double distance[], int *n);
+int nearest_profiles(const double q[N_TASKs], int k, int nearest[], double distance[]);
+int nearest_profiles_brute_force(const double q[N_TASKs], int k, int nearest[], double distance[]);
+void build_profile_index();
+void set_lesion_spacing();
+int implied_variant(const int nearest[], int n);
+void classify_cases();
+double latency_percentile(double q);
+void print_service_metrics(FILE *fp);
+int valid_scores(const double data[N_TASKs]);
+void answer_query(const double data[N_TASKs], char *answer, size_t size);
+int serve();
+int parse_variant(const char *text);
+int split_registry_row(char *line, char *field[2 + N_TASKs]);
+int registry_header(char *line);
+void parse_registry_row(char *line, REGISTRY_ROW *r);
+void fit_registry_row(REGISTRY_ROW *r);
+int fit_registry();
+double sample_normal(unsigned long long *state);
+double wall_time();
+void batch_spread(double (*in)[BATCH], const double *weight, int n_to, int n_from, 
+	double (*from)[BATCH], const double *factor);
+void batch_update(double (*act)[BATCH], double (*in)[BATCH], int n, const double *keep);
+void sample_lesions(int variant, unsigned long long *state, double lesion[N_GROUPs][BATCH]);
+void simulate_batch(const WEIGHT_SET *w, const double normal[N_TASKs], int variant, 
+	unsigned long long *state, double lesion[N_GROUPs][BATCH], double score[N_TASKs][BATCH]);
+void simulate_lesion_batch(const WEIGHT_SET *w, const double normal[N_TASKs], 
+	double lesion[N_GROUPs][BATCH], int weight_lesion, double score[N_TASKs][BATCH]);
+void simulate_populations();
+size_t format_patient_record(char *text, const PATIENT_RECORD *r);
+int start_result_writer(const char *file);
+void push_result(const PATIENT_RECORD *r);
+void write_result(const PATIENT_RECORD *r);
+int pop_result(PATIENT_RECORD *r);
+void *result_writer(void *unused);
+void wake_result_writer();
+void stop_result_writer();
+void *arena_alloc(ARENA *a, size_t size);
+void allocate_state_tensors(ARENA *a);
+void allocate_state();
+double grid_value(int i);
+void sweep_lesion_grid();
+void batch_lesion_factors(const WEIGHT_SET *w, double lesion[N_GROUPs][BATCH], int weight_lesion, 
+	double f[N_BLOCKs][BATCH], double keep[N_LAYERs][BATCH]);
+void to_float(float *to, const double *from, int n);
+void get_float_weight_set(const WEIGHT_SET *w, FLOAT_WEIGHT_SET *fw);
+void float_batch_spread(float (*in)[BATCH], const float *weight, int n_to, int n_from, 
+	float (*from)[BATCH], const float *factor);
+void mixed_batch_spread(double (*in)[BATCH], const float *weight, int n_to, int n_from, 
+	float (*from)[BATCH], const float *factor);
+void float_batch_update(float (*act)[BATCH], float (*in)[BATCH], int n, const float *keep);
+void mixed_batch_update(float (*act)[BATCH], double (*in)[BATCH], int n, const float *keep);
+void simulate_lesion_batch_float(const WEIGHT_SET *w, const double normal[N_TASKs], 
+	double lesion[N_GROUPs][BATCH], int weight_lesion, int mixed, double score[N_TASKs][BATCH]);
+void batch_scores(const WEIGHT_SET *w, const double normal[N_TASKs], double (*score)[N_GROUPs][N_TASKs]);
+void best_fits(double (*score)[N_GROUPs][N_TASKs], int a, int best[N_GROUPs], double mae[N_GROUPs]);
+void report_precision();
+void build_system_matrix(const WEIGHT_SET *w, double A[N_NODEs][N_NODEs]);
+void get_external_input_vector(double e[N_NODEs]);
+void layers_to_vector(const LAYERS *x, double v[N_NODEs]);
+void vector_to_layers(const double v[N_NODEs], LAYERS *x);
+const PROPAGATOR *derive_propagator(const WEIGHT_SET *w);
+void propagate(LAYERS *act, const LAYERS *input, const WEIGHT_SET *w);
+int lu_factor(double G[N_NODEs][N_NODEs], int pivot[N_NODEs]);
+void lu_solve(double G[N_NODEs][N_NODEs], int pivot[N_NODEs], double b[N_NODEs]);
+void mat_mul(double C[N_NODEs][N_NODEs], double A[N_NODEs][N_NODEs], double B[N_NODEs][N_NODEs]);
+void apply_matrix_power(double P[N_POWERs][N_NODEs][N_NODEs], int n, double v[N_NODEs]);
+int set_up_closed_form();
+int compute_mean_activation_closed_form();
+void set_up_fit_cases();
+void run_fit_trial(const WEIGHT_SET *w, int task, double *target, double *relative);
+void sweep_fit_errors(const double rate[N_RATEs], double study_error[N_STUDIES + 1]);
+int valid_rates(const double rate[N_RATEs]);
+void print_rates(const double rate[N_RATEs]);
+void fit_rates();
 
 
 /*****************
  * MAIN ROUTINES *
  *****************/
 
-int main()
+int main(int argc, char *argv[])
  {
 
 	double ls; /* exact lesion value */
+	int i;
+
+	for (i = 1; i < argc; i++)
+		if (strcmp(argv[i], "watch") == 0)
+			return watch_live_stream();
+		else if (strncmp(argv[i], "probes=", 7) == 0)
+			PROBE_SPEC = argv[i] + 7;
+		else if (strncmp(argv[i], "studies=", 8) == 0) {
+			STUDY_FILE = argv[i] + 8;
+			RUN_STUDIES = 1;
+		}
+		else if (strcmp(argv[i], "kernel") == 0)
+			WRITE_KERNEL = 1;
+		else if (sscanf(argv[i], "values=%d", &N_lesion_values) != 1 
+			&& sscanf(argv[i], "steps=%d", &N_STEPs) != 1) {
+			fprintf(stderr, "usage: %s [values=<lesion values>] [steps=<time steps>] [probes=<probes>]\n"
+				"       [studies=<study definitions>] [kernel]\n       %s watch\n", argv[0], argv[0]);
+			return 1;
+		}
+	if (N_lesion_values <= 0)
+		N_lesion_values = (DECAY_LESION ? 66 : 100);
+	if (N_lesion_values < 2 || N_STEPs < 1) {
+		fprintf(stderr, "need at least 2 lesion values and 1 step\n");
+		return 1;
+	}
+	if (!parse_probes(PROBE_SPEC))
+		return 1;
+	set_lesion_spacing();
+	if (EXPONENTIAL_INTEGRATION && (SHOW_SENSITIVITIES || POPULATION || GRID_SWEEP || PRECISION_REPORT)) {
+		fprintf(stderr, "the sensitivities and the batched simulations need forward Euler steps\n");
+		return 1;
+	}
+
+	allocate_state();
+
+	if (SERVE)
+		return serve();
+
+	if (REGISTRY_FITS)
+		return fit_registry();
+
+	if (QUERY_PREFIX_SUMS)
+		return query_prefix_sums();
+
+	if (LIVE_STREAM && !open_live_stream())
+		return 1;
+
+	/* before anything derives weights from the network; the modes with cases take them from there too */
+	if ((RUN_STUDIES || FIT_RATES || CLASSIFY_CASES || PROGRESSION || BOOTSTRAP || LOOKUP_FITS || POPULATION) 
+		&& !read_study_definitions(STUDY_FILE))
+		return 1;
+
+	if (WRITE_KERNEL)
+		return !write_network_kernel(KERNEL_FILE);
+
+	KERNEL_FITS = network_fits_kernel();
+
+	if (SHOW_SENSITIVITIES)
+		derive_spread_links();
 
     print_heading();
 
 	print_parameters();
 
+	derive_competitor_sets();
+
+	if (SHOW_ERROR_TYPES)
+		print_competitor_sets();
+
 	set_spreading_rates();
 
 	
 	if (WEIGHT_LESION)
-	for (lesion_value = 0, ls = 0.0; lesion_value < N_lesion_values; lesion_value++, ls += 0.01)
+	for (lesion_value = 0, ls = 0.0; lesion_value < N_lesion_values; lesion_value++, ls += 1.0 / N_lesion_values)
 		WEIGHT_value[lesion_value] = ls; /* values between maximally damaged, 0.0, 
-										    and minimally damaged, 0.99 */
+										    and minimally damaged, 0.99 with 100 values */
 
 	if (DECAY_LESION)
- 	for (lesion_value = 0, ls = 1.01; lesion_value < N_lesion_values; lesion_value++, ls += 0.01)
-		DECAY_value[lesion_value] = ls; /* values between minimally damaged, 1.01, 
+ 	for (lesion_value = 0, ls = 1.0 + 0.66 / N_lesion_values; lesion_value < N_lesion_values; 
+	     lesion_value++, ls += 0.66 / N_lesion_values)
+		DECAY_value[lesion_value] = ls; /* values between minimally damaged, 1.01 with 66 values, 
 										   and maximally damaged, i.e., full decay, 1.66 */
 
+	if (FIT_RATES)
+		fit_rates();
+
+	if (RUN_STUDIES)
+		return run_studies();
+
+	if (POPULATION)
+		simulate_populations();
+
+	if (CLASSIFY_CASES)
+		classify_cases();
+
+	if (GRID_SWEEP)
+		sweep_lesion_grid();
+
+	if (PRECISION_REPORT)
+		report_precision();
+
+	if (LOOKUP_FITS) {
+		print_lookup_fits();
+		return 0;
+	}
 
 	for (assessment = 0; assessment < N_ASSESSMENTs; assessment++) {
 
 		set_real_data_matrix();
 
-		for (group = 0; group < N_GROUPs; group++) {
+		/* a follow up fits against the simulations of its baseline */
+		if (PROGRESSION && (assessment == BRAMBATI_T2 || assessment == ROHRERMANDELLI_T2)) {
+			compute_fits_and_print_results_on_screen();
+			getchar();
+			continue;
+		}
 
-			for (task = 0; task < N_TASKs; task++) {
+		/* the simulations do not depend on the assessment, so MEAN_ONLY keeps the means of the first */
+		for (group = 0; group < N_GROUPs && !(MEAN_ONLY && assessment > 0); group++) {
+
+			/* tasks innermost, so that the closed form can reuse A across tasks */
+			for (lesion_value = 0; lesion_value < N_lesion_values; lesion_value++) {
 
-				for (lesion_value = 0; lesion_value < N_lesion_values; lesion_value++) {
+				for (task = 0; task < N_TASKs; task++) {
 
 					reset_network();
 
 					set_aphasic_parameters();
 
+					if (SHOW_SENSITIVITIES)
+						compute_sensitivities();
+
+					if (MEAN_ONLY && compute_mean_activation_closed_form())
+						continue;
+
 					for (T = 0, step = 0; T < (N_STEPs * STEP_SIZE); T += STEP_SIZE, step++) {
 
 						update_network();
 						determine_activation_critical_nodes();
+						if (SHOW_LUCE_RESULTS)
+							update_response_selection();
+						if (EARLY_TERMINATION && check_early_termination()) {
+							finish_early_termination();
+							break;
+						}
 
 					}
+
+					if (SHOW_LUCE_RESULTS)
+						finish_response_selection();
 				}
 			}
 
 		}
 
-			compute_activation_results();
+			if (!MEAN_ONLY)
+				compute_activation_results();
+
+			/* the trajectories are the same for every assessment */
+			if (SAVE_PREFIX_SUMS && !MEAN_ONLY && assessment == 0)
+				save_prefix_sums(PREFIX_FILE);
+
+			if (N_EXTRA_PROBEs > 0 && !MEAN_ONLY && assessment == 0)
+				write_probes(PROBE_FILE);
 
 
 			compute_fits_and_print_results_on_screen();
@@ -519,65 +1280,12 @@ void set_real_data_matrix()
 
  void set_spreading_rates()
  {
-   int i,j;
    
-for(lesion_value=0; lesion_value < N_lesion_values; lesion_value++) 
- for(group=0; group < N_GROUPs; group++)
-  for(task=0; task < N_TASKs; task++) 
-	 for(step=0; step < N_STEPs; step++) {
-	  ACT_C[lesion_value][step][group][task] = 0.0;
-	  ACT_S[lesion_value][step][group][task] = 0.0;
-      ACT_CT[lesion_value][step][group][task] = 0.0;
-      ACT_CR[lesion_value][step][group][task] = 0.0;
-      ACT_LT[lesion_value][step][group][task] = 0.0;
-      ACT_LR[lesion_value][step][group][task] = 0.0;
-      ACT_ST[lesion_value][step][group][task] = 0.0;
-      ACT_SR[lesion_value][step][group][task] = 0.0;
-	 }
+  memset(TRAJECTORY, 0, sizeof(double) * N_lesion_values * N_GROUPs * N_TASKs * N_PROBEs * N_STEPs);
  
 
-  for(i=0;i<N_CONCEPTs;i++)
-     for(j=0;j<N_CONCEPTs;j++) 
-	CC_con[i][j]*=SEM_rate;
-
-  for(i=0;i<N_CONCEPTs;i++)
-     for(j=0;j<N_LEMMAs;j++) 
-	CL_con[i][j]*=LEM_rate;
-
-	 
-   for(i=0;i<N_LEMMAs;i++)
-     for(j=0;j<N_MORPHEMEs;j++) 
-	LM_con[i][j]*=LEX_rate;
-	 
-
-  for(i=0;i<N_MORPHEMEs;i++)
-     for(j=0;j<N_PHONEMEs;j++) 
-	MP_con[i][j]*=LEX_rate;
-
-  for(i=0;i<N_PHONEMEs;i++)
-     for(j=0;j<N_SYLLABLEs;j++) 
-	PS_con[i][j]*=LEX_rate;
-
-
-  /* connections for input phonemes to output phonemes, input morphemes, 
-     input morphemes to lemmas */
-
-  for(i=0;i<N_PHONEMEs;i++)
-     for(j=0;j<N_PHONEMEs;j++) 
-	PP_con[i][j]*=LEX_rate;
-
-  for(i=0;i<N_PHONEMEs;i++)
-     for(j=0;j<N_MORPHEMEs;j++) 
-	PiM_con[i][j]*= (FR * LEX_rate);
-
-
-  for(i=0;i<N_MORPHEMEs;i++)
-     for(j=0;j<N_MORPHEMEs;j++) 
-	iMM_con[i][j]*=LEX_rate;
-
-  for(i=0;i<N_MORPHEMEs;i++)
-     for(j=0;j<N_LEMMAs;j++) 
-	iML_con[i][j]*=LEX_rate;
+  /* the rates are no longer applied to the *_con matrices here, but when 
+     deriving the weight set of a configuration, see get_weight_set() */
 
   }
 
@@ -590,25 +1298,27 @@ for(lesion_value=0; lesion_value < N_lesion_values; lesion_value++)
 
 
    for(i=0;i<N_CONCEPTs;i++) 
-     C_node_act[i]=0.0;
+     node_act.C[i]=0.0;
 
    for(i=0;i<N_LEMMAs;i++) 
-     L_node_act[i]=0.0;
+     node_act.L[i]=0.0;
 
    for(i=0;i<N_MORPHEMEs;i++)
-     M_node_act[i]=0.0;
+     node_act.M[i]=0.0;
 
    for(i=0;i<N_MORPHEMEs;i++) 
-     iM_node_act[i]=0.0;
+     node_act.iM[i]=0.0;
   
    for(i=0;i<N_PHONEMEs;i++)
-     iP_node_act[i]=0.0;
+     node_act.iP[i]=0.0;
 
    for(i=0;i<N_PHONEMEs;i++)
-     oP_node_act[i]=0.0;
+     node_act.oP[i]=0.0;
    
    for(i=0;i<N_SYLLABLEs;i++) 
-     S_node_act[i]=0.0;
+     node_act.S[i]=0.0;
+
+   TAIL_RATE = 0.0;
 
  }
 
@@ -665,6 +1375,173 @@ void set_aphasic_parameters()
   else
 	  DECAY_INCREASE_LOGOPENIC = 1.0; /* normal */
 
+
+  W = get_weight_set();
+
+}
+
+
+
+/* given rates, no lesion */
+
+void get_rate_configuration(WEIGHT_CONFIGURATION *c, const double rate[N_RATEs])
+{
+	int i;
+
+	memset(c, 0, sizeof(*c)); /* no padding garbage, so memcmp() compares configurations */
+
+	for (i = 0; i < N_RATEs; i++)
+		c->rate[i] = rate[i];
+	for (i = 0; i < N_BLOCKs; i++)
+		c->weight_factor[i] = 1.0;
+	for (i = 0; i < N_LAYERs; i++)
+		c->decay_factor[i] = 1.0;
+}
+
+
+/* adds a lesion at a site to a configuration */
+
+void add_lesion(WEIGHT_CONFIGURATION *c, int site, double weight_factor, double decay_factor)
+{
+	add_lesion_at(c, SITE_BLOCKS[site], SITE_LAYERS[site], weight_factor, decay_factor);
+}
+
+
+/* the same for a site given by its blocks and layers */
+
+void add_lesion_at(WEIGHT_CONFIGURATION *c, const int blocks[N_BLOCKs], const int layers[N_LAYERs], 
+	double weight_factor, double decay_factor)
+{
+	int i;
+
+	for (i = 0; i < N_BLOCKs; i++)
+		if (blocks[i])
+			c->weight_factor[i] *= weight_factor;
+	for (i = 0; i < N_LAYERs; i++)
+		if (layers[i])
+			c->decay_factor[i] *= decay_factor;
+}
+
+
+/* current rates and lesion factors */
+
+void get_weight_configuration(WEIGHT_CONFIGURATION *c)
+{
+	double rate[N_RATEs];
+	int i;
+
+	for (i = 0; i < N_RATEs; i++)
+		rate[i] = *RATE_VARIABLE[i];
+
+	get_rate_configuration(c, rate);
+	add_lesion(c, NONFLUENT_AGRAMMATIC, CONNECTION_DECREASE_NONFLUENT_AGRAMMATIC, 
+	           DECAY_INCREASE_NONFLUENT_AGRAMMATIC);
+	add_lesion(c, SEMANTIC_DEMENTIA, CONNECTION_DECREASE_SEMANTIC_DEMENTIA, 
+	           DECAY_INCREASE_SEMANTIC_DEMENTIA);
+	add_lesion(c, LOGOPENIC, CONNECTION_DECREASE_LOGOPENIC, DECAY_INCREASE_LOGOPENIC);
+}
+
+
+/* applies the rates and lesion factors of w->config to the base topology */
+
+void derive_weight_set(WEIGHT_SET *w)
+{
+	const double *r = w->config.rate;
+	const double *f = w->config.weight_factor;
+	const double *d = w->config.decay_factor;
+	int i, j;
+
+	w->picture_input = f[PICTURE_BLOCK] * r[R_EXTIN];
+	w->extin = r[R_EXTIN];
+
+	for (i = 0; i < N_CONCEPTs; i++)
+		for (j = 0; j < N_CONCEPTs; j++)
+			w->CC[i][j] = CC_con[j][i] * r[R_SEM] * f[CC_BLOCK];
+
+	for (i = 0; i < N_CONCEPTs; i++)
+		for (j = 0; j < N_LEMMAs; j++)
+			w->LC[i][j] = CL_con[j][i] * r[R_LEM] * f[LC_BLOCK];
+
+	for (i = 0; i < N_LEMMAs; i++)
+		for (j = 0; j < N_CONCEPTs; j++)
+			w->CL[i][j] = CL_con[j][i] * r[R_LEM] * f[CL_BLOCK];
+
+	for (i = 0; i < N_LEMMAs; i++)
+		for (j = 0; j < N_MORPHEMEs; j++)
+			w->iML[i][j] = iML_con[j][i] * r[R_LEX] * f[iML_BLOCK];
+
+	for (i = 0; i < N_MORPHEMEs; i++)
+		for (j = 0; j < N_LEMMAs; j++)
+			w->LM[i][j] = r[R_LEMLEXFRAC] * LM_con[j][i] * r[R_LEX] * f[LM_BLOCK];
+
+	for (i = 0; i < N_MORPHEMEs; i++)
+		for (j = 0; j < N_MORPHEMEs; j++)
+			w->iMM[i][j] = iMM_con[j][i] * r[R_LEX] * f[iMM_BLOCK];
+
+	for (i = 0; i < N_PHONEMEs; i++)
+		for (j = 0; j < N_MORPHEMEs; j++)
+			w->MP[i][j] = MP_con[j][i] * r[R_LEX] * f[MP_BLOCK];
+
+	for (i = 0; i < N_PHONEMEs; i++)
+		for (j = 0; j < N_PHONEMEs; j++)
+			w->iPoP[i][j] = PP_con[j][i] * r[R_LEX] * f[iPoP_BLOCK];
+
+	for (i = 0; i < N_SYLLABLEs; i++)
+		for (j = 0; j < N_PHONEMEs; j++)
+			w->PS[i][j] = PS_con[j][i] * r[R_LEX] * f[PS_BLOCK];
+
+	for (i = 0; i < N_PHONEMEs; i++)
+		for (j = 0; j < N_PHONEMEs; j++)
+			w->oPiP[i][j] = PP_con[j][i] * r[R_LEX] * f[oPiP_BLOCK];
+
+	for (i = 0; i < N_MORPHEMEs; i++)
+		for (j = 0; j < N_PHONEMEs; j++)
+			w->PiM[i][j] = PiM_con[j][i] * (r[R_FR] * r[R_LEX]) * f[PiM_BLOCK];
+
+	w->keep_C = 1.0 - (r[R_DECAY] * d[C_LAYER]);
+	w->keep_L = 1.0 - (r[R_DECAY] * d[L_LAYER]);
+	w->keep_M = 1.0 - (r[R_DECAY] * d[M_LAYER]);
+	w->keep_oP = 1.0 - (r[R_DECAY] * d[oP_LAYER]);
+	w->keep_iP = 1.0 - (r[R_DECAY] * d[iP_LAYER]);
+	w->keep_iM = 1.0 - (r[R_DECAY] * d[iM_LAYER]);
+	w->keep_S = 1.0 - (r[R_DECAY] * d[S_LAYER]);
+
+	w->propagator = (EXPONENTIAL_INTEGRATION ? derive_propagator(w) : NULL);
+}
+
+
+/* 
+   Weight set of the current configuration: the last one used, another 
+   cached one, or a newly derived one (replacing the oldest when full).
+*/
+
+WEIGHT_SET *get_weight_set()
+{
+	WEIGHT_CONFIGURATION c;
+	WEIGHT_SET *w;
+	int i, n;
+
+	get_weight_configuration(&c);
+
+	if (W != NULL && memcmp(&W->config, &c, sizeof(c)) == 0)
+		return W;
+
+	n = (N_CACHED_WEIGHT_SETs < N_WEIGHT_SETs ? N_CACHED_WEIGHT_SETs : N_WEIGHT_SETs);
+	for (i = 0; i < n; i++)
+		if (memcmp(&WEIGHT_CACHE[i].config, &c, sizeof(c)) == 0)
+			return &WEIGHT_CACHE[i];
+
+	i = N_CACHED_WEIGHT_SETs++ % N_WEIGHT_SETs;
+	w = &WEIGHT_CACHE[i];
+	w->config = c;
+	derive_weight_set(w);
+	TANGENT_GROUP[i] = -1;
+	if (EXPONENTIAL_INTEGRATION) {
+		PROPAGATOR_CACHE[i] = *w->propagator;
+		w->propagator = &PROPAGATOR_CACHE[i];
+	}
+
+	return w;
 }
 
 
@@ -675,44 +1552,33 @@ void set_aphasic_parameters()
 
  void update_network()
  {
-   set_input_to_zero();
-   get_external_input();
-   get_internal_input();
-   update_activation_of_nodes();
+   network_step(&node_act, W, task, T);
  }
 
 
 
- void set_input_to_zero()
- {
-   int i;
-
-   for(i=0;i<N_CONCEPTs;i++) 
-       input_C[i]=0.0;
-
-   for(i=0;i<N_LEMMAs;i++)
-       input_L[i]=0.0;
-
-   for(i=0;i<N_MORPHEMEs;i++)
-       input_M[i]=0.0;
-
-   for(i=0;i<N_MORPHEMEs;i++) 
-       input_iM[i]=0.0;
-   
-   for(i=0;i<N_PHONEMEs;i++) 
-       input_iP[i]=0.0;
-
-   for(i=0;i<N_PHONEMEs;i++) 
-       input_oP[i]=0.0;
+/* 
+   One step of a trial at time T, for any network state and weight set; 
+   uses no other globals than the (constant) topology and timing, so that 
+   trials can be run in parallel.
+*/
 
-   for(i=0;i<N_SYLLABLEs;i++) 
-       input_S[i]=0.0;
- 
+ void network_step(LAYERS *act, const WEIGHT_SET *w, int task, int T)
+ {
+   LAYERS input;
 
-  }
+   memset(&input, 0, sizeof(input));
+   get_external_input(&input, w, task, T);
+   if (EXPONENTIAL_INTEGRATION) {
+     propagate(act, &input, w);
+     return;
+   }
+   get_internal_input(act, &input, w);
+   update_activation_of_nodes(act, &input, w);
+ }
 
 
- void get_external_input()
+ void get_external_input(LAYERS *input, const WEIGHT_SET *w, int task, int T)
  {
 
 
@@ -720,12 +1586,12 @@ void set_aphasic_parameters()
 
     /* picture input */
 	   if (T >= 0 && T < PICTURE_DURATION) 
-		   input_C[CAT] += CONNECTION_DECREASE_SEMANTIC_DEMENTIA * EXTIN;
+		   input->C[CAT] += w->picture_input;
 
     /* enhancement */
   	  if( (T >= (0 + 1 * CYCLE_TIME)) 
 		         &&  (T < (1 * CYCLE_TIME + PICTURE_DURATION))  ) 
-	     input_C[CAT]+= EXTIN;
+	     input->C[CAT]+= w->extin;
 	}
    
 
@@ -734,18 +1600,18 @@ void set_aphasic_parameters()
  
     /* spoken word input */
       if((0 <= T) && (T < SEGMENT_DURATION)) {
-	         input_iP[pK]+=EXTIN;
+	         input->iP[pK]+=w->extin;
              }
 
       if((SEGMENT_DURATION <= T) 
           && (T < (2 * SEGMENT_DURATION))) {
-	         input_iP[pE]+=EXTIN;
+	         input->iP[pE]+=w->extin;
              }
 
 
      if((2 * SEGMENT_DURATION <= T) 
          && (T < (3 * SEGMENT_DURATION))) {
-	         input_iP[pT]+=EXTIN;
+	         input->iP[pT]+=w->extin;
              }
  
       }
@@ -753,222 +1619,5047 @@ void set_aphasic_parameters()
  }
 
 
- void get_internal_input()
+ void get_internal_input(const LAYERS *act, LAYERS *input, const WEIGHT_SET *w)
  {
    int i,j;
 
+#ifdef NETWORK_KERNEL
+   if (KERNEL_FITS) {
+     kernel_internal_input(act, input, w);
+     return;
+   }
+#endif
 
  /* input activation for concept nodes */
 
   for(i=0;i<N_CONCEPTs;i++)
 	  for(j=0;j<N_CONCEPTs;j++) 
-       input_C[i]+=(C_node_act[j] 
-	                * (CC_con[j][i] * CONNECTION_DECREASE_SEMANTIC_DEMENTIA ) );
+       input->C[i]+=(act->C[j] * w->CC[i][j]);
 
   for(i=0;i<N_CONCEPTs;i++)
      for(j=0;j<N_LEMMAs;j++)
-       input_C[i]+=(L_node_act[j] 
-	              * CL_con[j][i] * CONNECTION_DECREASE_SEMANTIC_DEMENTIA );
+       input->C[i]+=(act->L[j] * w->LC[i][j]);
 
 
  /* input activation for lemma nodes */
   for(i=0;i<N_LEMMAs;i++)
 	  for(j=0;j<N_CONCEPTs;j++) 
-        input_L[i]+=( C_node_act[j] * CL_con[j][i] 
-	                  *  CONNECTION_DECREASE_SEMANTIC_DEMENTIA );
+        input->L[i]+=(act->C[j] * w->CL[i][j]);
 
   for(i=0;i<N_LEMMAs;i++)
      for(j=0;j<N_MORPHEMEs;j++)                      
-        input_L[i]+=( iM_node_act[j] * iML_con[j][i]);
+        input->L[i]+=(act->iM[j] * w->iML[i][j]);
 
 
  /* input activation for output morpheme nodes */
    for(i=0;i<N_MORPHEMEs;i++)
      for(j=0;j<N_LEMMAs;j++) 
-	    input_M[i]+=( L_node_act[j] * LEMLEXFRAC * LM_con[j][i] * CONNECTION_DECREASE_LOGOPENIC); 
+	    input->M[i]+=(act->L[j] * w->LM[i][j]); 
 
 
   for(i=0;i<N_MORPHEMEs;i++)
      for(j=0;j<N_MORPHEMEs;j++)
-        input_M[i]+=( iM_node_act[j] * iMM_con[j][i] * CONNECTION_DECREASE_LOGOPENIC);
+        input->M[i]+=(act->iM[j] * w->iMM[i][j]);
 
 
 
  /* input activation for output phoneme nodes */
   for(i=0;i<N_PHONEMEs;i++)
      for(j=0;j<N_MORPHEMEs;j++) 
-	  input_oP[i]+=( M_node_act[j] * MP_con[j][i] 
-		  * CONNECTION_DECREASE_NONFLUENT_AGRAMMATIC * CONNECTION_DECREASE_LOGOPENIC);
+	  input->oP[i]+=(act->M[j] * w->MP[i][j]);
 
  for (i = 0; i < N_PHONEMEs; i++)
 	  for (j = 0; j < N_PHONEMEs; j++)
-		input_oP[i] += (iP_node_act[j] * PP_con[j][i] * CONNECTION_DECREASE_NONFLUENT_AGRAMMATIC 
-			                  * CONNECTION_DECREASE_LOGOPENIC);
+		input->oP[i] += (act->iP[j] * w->iPoP[i][j]);
 
 
  /* input activation for syllable program nodes */
    for(i=0;i<N_SYLLABLEs;i++)
      for(j=0;j<N_PHONEMEs;j++)  
-	input_S[i]+=( oP_node_act[j] * PS_con[j][i] * CONNECTION_DECREASE_NONFLUENT_AGRAMMATIC);
+	input->S[i]+=(act->oP[j] * w->PS[i][j]);
 
 
 
  /* input activation for input phoneme nodes */
   for(i=0;i<N_PHONEMEs;i++)
      for(j=0;j<N_PHONEMEs;j++) 
-	input_iP[i]+=( oP_node_act[j] * PP_con[j][i] * CONNECTION_DECREASE_NONFLUENT_AGRAMMATIC 
-		              * CONNECTION_DECREASE_LOGOPENIC);
+	input->iP[i]+=(act->oP[j] * w->oPiP[i][j]);
  
  /* input activation for input morpheme nodes */
 	  for(i=0;i<N_MORPHEMEs;i++)
         for(j=0;j<N_PHONEMEs;j++) 
-	       input_iM[i]+=( iP_node_act[j] * PiM_con[j][i]);
+	       input->iM[i]+=(act->iP[j] * w->PiM[i][j]);
  
  }
 
 
 
- void update_activation_of_nodes()
+ void update_activation_of_nodes(LAYERS *act, const LAYERS *input, const WEIGHT_SET *w)
  {
    int i;
 
    for(i=0;i<N_CONCEPTs;i++)
-     C_node_act[i]=((C_node_act[i] 
-                     * (1.0 - (DECAY_rate * DECAY_INCREASE_SEMANTIC_DEMENTIA)) ) + input_C[i]);
+     act->C[i]=((act->C[i] 
+                     * w->keep_C) + input->C[i]);
 
    for(i=0;i<N_LEMMAs;i++) 
-     L_node_act[i]=((L_node_act[i] * (1.0 - DECAY_rate)) + input_L[i]);
+     act->L[i]=((act->L[i] * w->keep_L) + input->L[i]);
 
     
    for(i=0;i<N_MORPHEMEs;i++)
-       M_node_act[i]=((M_node_act[i] * (1.0 - (DECAY_rate * DECAY_INCREASE_LOGOPENIC) )) + input_M[i]);
+       act->M[i]=((act->M[i] * w->keep_M) + input->M[i]);
 
      for(i=0;i<N_PHONEMEs;i++) 
-       oP_node_act[i]=((oP_node_act[i] * (1.0 - (DECAY_rate * DECAY_INCREASE_NONFLUENT_AGRAMMATIC))) + input_oP[i]);
+       act->oP[i]=((act->oP[i] * w->keep_oP) + input->oP[i]);
        
      for(i=0;i<N_PHONEMEs;i++) 
-       iP_node_act[i]=((iP_node_act[i] * (1.0 - DECAY_rate)) + input_iP[i]);
+       act->iP[i]=((act->iP[i] * w->keep_iP) + input->iP[i]);
 
    for(i=0;i<N_MORPHEMEs;i++)
-       iM_node_act[i]=((iM_node_act[i] * (1.0 - DECAY_rate)) + input_iM[i]);
+       act->iM[i]=((act->iM[i] * w->keep_iM) + input->iM[i]);
    
    for(i=0;i<N_SYLLABLEs;i++) 
-       S_node_act[i]=((S_node_act[i] * (1.0 - DECAY_rate)) + input_S[i]);
+       act->S[i]=((act->S[i] * w->keep_S) + input->S[i]);
 
 
  }
 
 
-void determine_activation_critical_nodes()
-{
-	ACT_C[lesion_value][step][group][task] = C_node_act[CAT];
-	ACT_S[lesion_value][step][group][task] = S_node_act[CAT];
-	ACT_CT[lesion_value][step][group][task] = C_node_act[CAT];
-	ACT_CR[lesion_value][step][group][task] = C_node_act[DOG];
-	ACT_LT[lesion_value][step][group][task] = L_node_act[CAT];
-	ACT_LR[lesion_value][step][group][task] = L_node_act[DOG];
-	ACT_ST[lesion_value][step][group][task] = S_node_act[CAT];
-	ACT_SR[lesion_value][step][group][task] = S_node_act[MAT];
-
-}
 
+/*
+   Early termination. After the last stimulus, the network only decays and 
+   spreads what is left, so the summed activation falls off geometrically. 
+   Once it is below TERMINATION_TOLERANCE of its peak, the step loop stops 
+   and the rest of the trial is filled in as a geometric tail with the 
+   contraction rate observed in the last step, see finish_early_termination(). 
+   The error in the means is bounded by the tolerance times the peak over 
+   (1 - rate) steps.
+*/
 
-void compute_activation_results()
-{
+ /* time (ms) from which there is no external input; keep in line with get_external_input() */
+ int stimulus_offset()
+ {
+   if (task == NAMING)
+	   return CYCLE_TIME + PICTURE_DURATION; /* end of the enhancement */
+   else
+	   return 3 * SEGMENT_DURATION;
+ }
 
-  int i;
 
-  for(lesion_value=0; lesion_value < N_lesion_values; lesion_value++)
-	for(group=0; group < N_GROUPs; group++) 
-		for(task=0; task < N_TASKs; task++) {
-	  TOTAL_ACT_C[lesion_value][group][task] = 0.0;
-	  TOTAL_ACT_S[lesion_value][group][task] = 0.0;
-	  MEAN_ACT_C[lesion_value][group][task] = 0.0;
-	  MEAN_ACT_S[lesion_value][group][task] = 0.0;
+ double summed_activation()
+ {
+   int i;
+   double sum = 0.0;
 
-	  TOTAL_ACT_CT[lesion_value][group][task] = 0.0;
-	  TOTAL_ACT_CR[lesion_value][group][task] = 0.0;
-	  MEAN_ACT_CT[lesion_value][group][task] = 0.0;
-	  MEAN_ACT_CR[lesion_value][group][task] = 0.0;
+   for(i=0;i<N_CONCEPTs;i++)  sum += fabs(node_act.C[i]);
+   for(i=0;i<N_LEMMAs;i++)    sum += fabs(node_act.L[i]);
+   for(i=0;i<N_MORPHEMEs;i++) sum += fabs(node_act.M[i]);
+   for(i=0;i<N_PHONEMEs;i++)  sum += fabs(node_act.oP[i]);
+   for(i=0;i<N_PHONEMEs;i++)  sum += fabs(node_act.iP[i]);
+   for(i=0;i<N_MORPHEMEs;i++) sum += fabs(node_act.iM[i]);
+   for(i=0;i<N_SYLLABLEs;i++) sum += fabs(node_act.S[i]);
 
-	  TOTAL_ACT_LT[lesion_value][group][task] = 0.0;
-	  TOTAL_ACT_LR[lesion_value][group][task] = 0.0;
-	  MEAN_ACT_LT[lesion_value][group][task] = 0.0;
-	  MEAN_ACT_LR[lesion_value][group][task] = 0.0;
+   return sum;
+ }
 
-	  TOTAL_ACT_ST[lesion_value][group][task] = 0.0;
-	  TOTAL_ACT_SR[lesion_value][group][task] = 0.0;
-	  MEAN_ACT_ST[lesion_value][group][task] = 0.0;
-	  MEAN_ACT_SR[lesion_value][group][task] = 0.0;
 
-	}
-  
- for(lesion_value=0; lesion_value < N_lesion_values; lesion_value++)
-   for(group=0; group < N_GROUPs; group++) 
-	   for(task=0; task < N_TASKs; task++) {
-         for(i = 0; i < N_STEPs; i++){ 
- 	       TOTAL_ACT_C[lesion_value][group][task] 
-		     += ACT_C[lesion_value][i][group][task];
-	       TOTAL_ACT_S[lesion_value][group][task] 
-		     += ACT_S[lesion_value][i][group][task];
-	       TOTAL_ACT_CT[lesion_value][group][task] 
-		     += ACT_CT[lesion_value][i][group][task];
-	       TOTAL_ACT_CR[lesion_value][group][task] 
-		     += ACT_CR[lesion_value][i][group][task];
-	       TOTAL_ACT_LT[lesion_value][group][task] 
-		     += ACT_LT[lesion_value][i][group][task];
-	       TOTAL_ACT_LR[lesion_value][group][task] 
-		     += ACT_LR[lesion_value][i][group][task];
-	       TOTAL_ACT_ST[lesion_value][group][task] 
-		     += ACT_ST[lesion_value][i][group][task];
-	       TOTAL_ACT_SR[lesion_value][group][task] 
-		     += ACT_SR[lesion_value][i][group][task];
-	     }
+ /* called after each step; sets TAIL_RATE and returns 1 once activation has died out */
+ int check_early_termination()
+ {
+   double total, rate;
 
-	     MEAN_ACT_C[lesion_value][group][task] 
-		   = (TOTAL_ACT_C[lesion_value][group][task] / N_STEPs);
-	     MEAN_ACT_S[lesion_value][group][task] 
-		   = (TOTAL_ACT_S[lesion_value][group][task] / N_STEPs);
-	     MEAN_ACT_CT[lesion_value][group][task] 
-		   = (TOTAL_ACT_CT[lesion_value][group][task] / N_STEPs);
-	     MEAN_ACT_CR[lesion_value][group][task] 
-		   = (TOTAL_ACT_CR[lesion_value][group][task] / N_STEPs);
-	     MEAN_ACT_LT[lesion_value][group][task] 
-		   = (TOTAL_ACT_LT[lesion_value][group][task] / N_STEPs);
-	     MEAN_ACT_LR[lesion_value][group][task] 
-		   = (TOTAL_ACT_LR[lesion_value][group][task] / N_STEPs);
-	     MEAN_ACT_ST[lesion_value][group][task] 
-		   = (TOTAL_ACT_ST[lesion_value][group][task] / N_STEPs);
-	     MEAN_ACT_SR[lesion_value][group][task] 
-		   = (TOTAL_ACT_SR[lesion_value][group][task] / N_STEPs);
-  
-	   }
-}
+   if (step == 0) {
+	   PEAK_TOTAL_ACT = 0.0;
+	   PREV_TOTAL_ACT = 0.0;
+   }
 
+   total = summed_activation();
+   if (total > PEAK_TOTAL_ACT)
+	   PEAK_TOTAL_ACT = total;
 
+   /* the next step must be free of external input */
+   if (T + STEP_SIZE >= stimulus_offset() && PREV_TOTAL_ACT > 0.0
+	   && total < TERMINATION_TOLERANCE * PEAK_TOTAL_ACT) {
+	   rate = total / PREV_TOTAL_ACT;
+	   if (rate > 0.0 && rate < 1.0)
+		   TAIL_RATE = rate;
+   }
 
+   PREV_TOTAL_ACT = total;
+   return (TAIL_RATE > 0.0);
+ }
 
-/*********************
- * FITS AND PRINTING *
- *********************/
 
- void print_heading()
+ void decay_network()
  {
-	 printf("\n");
-	 printf("WEAVER++/ARC model simulation of primary progressive aphasia (c) Ardi Roelofs\n");
-	 printf("Simulation of group studies \n");
+   int i;
 
+   for(i=0;i<N_CONCEPTs;i++)  node_act.C[i] *= TAIL_RATE;
+   for(i=0;i<N_LEMMAs;i++)    node_act.L[i] *= TAIL_RATE;
+   for(i=0;i<N_MORPHEMEs;i++) node_act.M[i] *= TAIL_RATE;
+   for(i=0;i<N_PHONEMEs;i++)  node_act.oP[i] *= TAIL_RATE;
+   for(i=0;i<N_PHONEMEs;i++)  node_act.iP[i] *= TAIL_RATE;
+   for(i=0;i<N_MORPHEMEs;i++) node_act.iM[i] *= TAIL_RATE;
+   for(i=0;i<N_SYLLABLEs;i++) node_act.S[i] *= TAIL_RATE;
  }
 
 
- void print_parameters()
+ /* 
+    Completes the trial from the terminating step without spreading. The 
+    trajectories and further probes are continued geometrically and the 
+    summed competitor activation gets its tail x r (1 - r^n) / (1 - r) for 
+    the n remaining steps. The Luce ratios do not change under scaling, only 
+    the set of nodes above threshold shrinks, so selection is only continued 
+    while a node of the response level is still selectable; after that the 
+    hazard is zero. The live stream stops at the terminating step.
+ */
+ void finish_early_termination()
  {
-	 
+   double r = TAIL_RATE, tail, sum, *x, *record;
+   const double *a;
+   int remaining = N_STEPs - 1 - step;
+   int p, s, level, type, i, n;
+   PROBE *q;
+
+   if (remaining <= 0)
+	   return;
+
+   for (p = 0; p < N_PROBEs; p++) {
+	   x = TRACE(lesion_value, group, task, p);
+	   for (s = step + 1; s < N_STEPs; s++)
+		   x[s] = x[s - 1] * r;
+   }
 
-     printf("Parameter values:\n");
-     printf("cycle time : %6d [ms]\n", CYCLE_TIME);
-     printf("sem_rate   : %.4f [prop/ms]\n",SEM_rate/STEP_SIZE);
-     printf("lem_rate   : %.4f [prop/ms]\n",LEM_rate/STEP_SIZE);
+   record = PROBE_RECORD + (((size_t) lesion_value * N_GROUPs + group) * N_TASKs + task) * PROBE_RECORD_SIZE;
+   for (q = EXTRA_PROBE; q < EXTRA_PROBE + N_EXTRA_PROBEs; q++) {
+	   a = layer_nodes(&node_act, q->layer, &n) + q->first;
+	   for (i = 0; i < q->n; i++) {
+		   x = record + q->offset + (size_t) i * q->n_samples;
+		   for (s = step / q->stride + 1; s < q->n_samples; s++)
+			   x[s] = a[i] * pow(r, s * q->stride - step);
+	   }
+   }
+
+   tail = r * (1.0 - pow(r, remaining)) / (1.0 - r);
+   for (level = 0; level < N_LEVELs; level++) {
+	   x = (level == CONCEPT_LEVEL ? node_act.C : level == LEMMA_LEVEL ? node_act.L : node_act.S);
+	   n = (level == CONCEPT_LEVEL ? N_CONCEPTs : level == LEMMA_LEVEL ? N_LEMMAs : N_SYLLABLEs);
+	   for (type = 0; type < N_ERROR_TYPEs; type++) {
+		   for (i = 0, sum = 0.0; i < n; i++)
+			   sum += COMPETITOR_MASK[level][type][i] * x[i];
+		   TOTAL_ACT_TYPE[lesion_value][group][task][level][type] += tail * sum;
+	   }
+   }
+
+   if (SHOW_LUCE_RESULTS) {
+	   level = RESPONSE_LEVEL[task];
+	   x = (level == CONCEPT_LEVEL ? node_act.C : level == LEMMA_LEVEL ? node_act.L : node_act.S);
+	   n = (level == CONCEPT_LEVEL ? N_CONCEPTs : level == LEMMA_LEVEL ? N_LEMMAs : N_SYLLABLEs);
+	   while (step < N_STEPs - 1) {
+		   for (i = 0; i < n && x[i] * r < SELECTION_THRESHOLD[level]; i++)
+			   ;
+		   if (i == n)
+			   break;
+		   step++;
+		   T += STEP_SIZE;
+		   decay_network();
+		   update_response_selection();
+	   }
+   }
+
+   /* leave the network as at the end of the trial */
+   TAIL_RATE = pow(r, N_STEPs - 1 - step);
+   decay_network();
+   TAIL_RATE = r;
+ }
+
+
+void determine_activation_critical_nodes()
+{
+	TRACE(lesion_value, group, task, PROBE_C)[step] = node_act.C[CAT];
+	TRACE(lesion_value, group, task, PROBE_S)[step] = node_act.S[CAT];
+	TRACE(lesion_value, group, task, PROBE_CT)[step] = node_act.C[CAT];
+	TRACE(lesion_value, group, task, PROBE_CR)[step] = node_act.C[DOG];
+	TRACE(lesion_value, group, task, PROBE_LT)[step] = node_act.L[CAT];
+	TRACE(lesion_value, group, task, PROBE_LR)[step] = node_act.L[DOG];
+	TRACE(lesion_value, group, task, PROBE_ST)[step] = node_act.S[CAT];
+	TRACE(lesion_value, group, task, PROBE_SR)[step] = node_act.S[MAT];
+	if (N_EXTRA_PROBEs > 0)
+		record_probes();
+	if (LIVE_STREAM)
+		publish_live_sample();
+
+	/* all competitor sets in one pass: masked sums over each level */
+	{
+	  int level, type, i, n;
+	  double *act;
+	  double sum;
+
+	  for (level = 0; level < N_LEVELs; level++) {
+
+		  if (level == CONCEPT_LEVEL) {
+			  act = node_act.C;
+			  n = N_CONCEPTs;
+		  }
+		  else if (level == LEMMA_LEVEL) {
+			  act = node_act.L;
+			  n = N_LEMMAs;
+		  }
+		  else {
+			  act = node_act.S;
+			  n = N_SYLLABLEs;
+		  }
+
+		  for (type = 0; type < N_ERROR_TYPEs; type++) {
+			  if (step == 0)
+				  TOTAL_ACT_TYPE[lesion_value][group][task][level][type] = 0.0;
+
+			  for (i = 0, sum = 0.0; i < n; i++)
+				  sum += COMPETITOR_MASK[level][type][i] * act[i];
+
+			  TOTAL_ACT_TYPE[lesion_value][group][task][level][type] += sum;
+		  }
+	  }
+	}
+
+}
+
+
+/*
+   Luce-ratio response selection (WEAVER++). In every step, the probability
+   of selecting a node at the response level of the task, given that no 
+   node has been selected before, is its activation divided by the summed 
+   activation of the target and all its competitors. Only nodes above the
+   SELECTION_THRESHOLD of the level can be selected. The hazard holds per 
+   CYCLE_TIME and is converted to the step size. Selection probabilities and
+   the expected latency are accumulated while running, so no trajectory is 
+   needed.
+*/
+
+void update_response_selection()
+{
+	double *act;
+	double a, den, theta, target, hazard, factor;
+	double type_hazard[N_ERROR_TYPEs];
+	int level, type, i, n;
+
+	if (step == 0) {
+		SURVIVAL = 1.0;
+		SUM_TIME_PROB = 0.0;
+		P_SELECT_TARGET[lesion_value][group][task] = 0.0;
+		for (type = 0; type < N_ERROR_TYPEs; type++)
+			P_SELECT_TYPE[lesion_value][group][task][type] = 0.0;
+	}
+
+	level = RESPONSE_LEVEL[task];
+	theta = SELECTION_THRESHOLD[level];
+
+	if (level == CONCEPT_LEVEL) {
+		act = node_act.C;
+		n = N_CONCEPTs;
+	}
+	else if (level == LEMMA_LEVEL) {
+		act = node_act.L;
+		n = N_LEMMAs;
+	}
+	else {
+		act = node_act.S;
+		n = N_SYLLABLEs;
+	}
+
+	a = act[TARGET_NODE[level]];
+	den = (a > 0.0 ? a : 0.0);
+	target = (a >= theta ? a : 0.0);
+
+	for (type = 0; type < N_ERROR_TYPEs; type++) {
+		type_hazard[type] = 0.0;
+		for (i = 0; i < n; i++) {
+			a = COMPETITOR_MASK[level][type][i] * act[i];
+			den += (a > 0.0 ? a : 0.0);
+			type_hazard[type] += (a >= theta ? a : 0.0);
+		}
+	}
+
+	if (den <= 0.0)
+		return;
+
+	/* summed Luce ratio of the selectable nodes, per step of STEP_SIZE ms */
+	hazard = target;
+	for (type = 0; type < N_ERROR_TYPEs; type++)
+		hazard += type_hazard[type];
+	hazard /= den;
+
+	if (hazard <= 0.0)
+		return;
+
+	factor = (1.0 - pow(1.0 - hazard, (double)STEP_SIZE / CYCLE_TIME)) / hazard;
+
+	P_SELECT_TARGET[lesion_value][group][task] += SURVIVAL * factor * target / den;
+	for (type = 0; type < N_ERROR_TYPEs; type++)
+		P_SELECT_TYPE[lesion_value][group][task][type] 
+		  += SURVIVAL * factor * type_hazard[type] / den;
+
+	SUM_TIME_PROB += SURVIVAL * factor * hazard * ((step + 1) * STEP_SIZE);
+	SURVIVAL *= (1.0 - factor * hazard);
+}
+
+
+void finish_response_selection()
+{
+	P_NO_RESPONSE[lesion_value][group][task] = SURVIVAL;
+
+	if (SURVIVAL < 1.0)
+		RESPONSE_LATENCY[lesion_value][group][task] = SUM_TIME_PROB / (1.0 - SURVIVAL);
+	else
+		RESPONSE_LATENCY[lesion_value][group][task] = 0.0;
+}
+
+
+/* 
+   Derives the competitors of TARGET_WORD from the connections.
+   A word is semantically related if its concept is linked to the target
+   concept, phonologically related if its morpheme shares an output phoneme 
+   with the target morpheme, mixed if both, and unrelated otherwise. 
+   Lemmas inherit the relation of their concept. The target syllable is the 
+   largest syllable made up of target phonemes only; other syllables are 
+   phonologically related if they share a phoneme with the target and 
+   semantically related if they are part of a semantically related word.
+*/
+
+void derive_competitor_sets()
+{
+	int word_lemma[N_CONCEPTs], word_morpheme[N_CONCEPTs];
+	int target_phoneme[N_PHONEMEs];
+	int word_type[N_CONCEPTs];
+	int i, j, k, level, type, semantic, phonological, size, best_size;
+
+	for (level = 0; level < N_LEVELs; level++)
+		for (type = 0; type < N_ERROR_TYPEs; type++) {
+			N_COMPETITORs[level][type] = 0;
+			for (i = 0; i < N_MAX_LEVEL_NODEs; i++)
+				COMPETITOR_MASK[level][type][i] = 0.0;
+		}
+
+	/* lemma and morpheme of each concept */
+	for (i = 0; i < N_CONCEPTs; i++) {
+		word_lemma[i] = -1;
+		word_morpheme[i] = -1;
+		for (j = 0; j < N_LEMMAs; j++)
+			if (CL_con[i][j] != 0.0)
+				word_lemma[i] = j;
+		if (word_lemma[i] >= 0)
+			for (j = 0; j < N_MORPHEMEs; j++)
+				if (LM_con[word_lemma[i]][j] != 0.0)
+					word_morpheme[i] = j;
+	}
+
+	for (k = 0; k < N_PHONEMEs; k++)
+		target_phoneme[k] = (word_morpheme[TARGET_WORD] >= 0
+			&& MP_con[word_morpheme[TARGET_WORD]][k] != 0.0);
+
+	/* relation of each word to the target */
+	for (i = 0; i < N_CONCEPTs; i++) {
+		if (i == TARGET_WORD) {
+			word_type[i] = -1;
+			continue;
+		}
+
+		semantic = (CC_con[TARGET_WORD][i] != 0.0 || CC_con[i][TARGET_WORD] != 0.0);
+
+		phonological = 0;
+		if (word_morpheme[i] >= 0)
+			for (k = 0; k < N_PHONEMEs; k++)
+				if (target_phoneme[k] && MP_con[word_morpheme[i]][k] != 0.0)
+					phonological = 1;
+
+		if (semantic && phonological)
+			word_type[i] = MIXED_ERROR;
+		else if (semantic)
+			word_type[i] = SEMANTIC_ERROR;
+		else if (phonological)
+			word_type[i] = PHONOLOGICAL_ERROR;
+		else
+			word_type[i] = UNRELATED_ERROR;
+	}
+
+	TARGET_NODE[CONCEPT_LEVEL] = TARGET_WORD;
+	TARGET_NODE[LEMMA_LEVEL] = word_lemma[TARGET_WORD];
+
+	for (i = 0; i < N_CONCEPTs; i++)
+		if (word_type[i] >= 0) {
+			COMPETITOR_MASK[CONCEPT_LEVEL][word_type[i]][i] = 1.0;
+			N_COMPETITORs[CONCEPT_LEVEL][word_type[i]]++;
+
+			if (word_lemma[i] >= 0) {
+				COMPETITOR_MASK[LEMMA_LEVEL][word_type[i]][word_lemma[i]] = 1.0;
+				N_COMPETITORs[LEMMA_LEVEL][word_type[i]]++;
+			}
+		}
+
+	/* target syllable */
+	TARGET_NODE[SYLLABLE_LEVEL] = -1;
+	for (j = 0, best_size = 0; j < N_SYLLABLEs; j++) {
+		for (k = 0, size = 0; k < N_PHONEMEs; k++)
+			if (PS_con[k][j] != 0.0) {
+				if (!target_phoneme[k])
+					break;
+				size++;
+			}
+		if (k == N_PHONEMEs && size > best_size) {
+			best_size = size;
+			TARGET_NODE[SYLLABLE_LEVEL] = j;
+		}
+	}
+
+	/* relation of each other syllable to the target */
+	for (j = 0; j < N_SYLLABLEs; j++) {
+		if (j == TARGET_NODE[SYLLABLE_LEVEL])
+			continue;
+
+		phonological = 0;
+		for (k = 0; k < N_PHONEMEs; k++)
+			if (PS_con[k][j] != 0.0 && target_phoneme[k])
+				phonological = 1;
+
+		semantic = 0;
+		for (i = 0; i < N_CONCEPTs; i++)
+			if ((word_type[i] == SEMANTIC_ERROR || word_type[i] == MIXED_ERROR) 
+				&& word_morpheme[i] >= 0) {
+				for (k = 0; k < N_PHONEMEs; k++)
+					if (PS_con[k][j] != 0.0 && MP_con[word_morpheme[i]][k] == 0.0)
+						break;
+				if (k == N_PHONEMEs)
+					semantic = 1;
+			}
+
+		if (semantic && phonological)
+			type = MIXED_ERROR;
+		else if (semantic)
+			type = SEMANTIC_ERROR;
+		else if (phonological)
+			type = PHONOLOGICAL_ERROR;
+		else
+			type = UNRELATED_ERROR;
+
+		COMPETITOR_MASK[SYLLABLE_LEVEL][type][j] = 1.0;
+		N_COMPETITORs[SYLLABLE_LEVEL][type]++;
+	}
+
+}
+
+
+void compute_activation_results()
+{
+  TRACE_METRICS m[3];
+  double threshold;
+  int i;
+
+ /* one pass over each pair of time series, see trace_metrics() */
+ for(lesion_value=0; lesion_value < N_lesion_values; lesion_value++)
+   for(group=0; group < N_GROUPs; group++) 
+	   for(task=0; task < N_TASKs; task++) {
+	     threshold = SELECTION_THRESHOLD[RESPONSE_LEVEL[task]];
+
+	     trace_metrics(TRACE(lesion_value, group, task, PROBE_C), 
+	                   TRACE(lesion_value, group, task, PROBE_S), threshold, m);
+	     TOTAL_ACT_C[lesion_value][group][task] = m[0].total;
+	     TOTAL_ACT_S[lesion_value][group][task] = m[1].total;
+
+	     trace_metrics(TRACE(lesion_value, group, task, PROBE_CT), 
+	                   TRACE(lesion_value, group, task, PROBE_CR), threshold, m);
+	     TOTAL_ACT_CT[lesion_value][group][task] = m[0].total;
+	     TOTAL_ACT_CR[lesion_value][group][task] = m[1].total;
+
+	     trace_metrics(TRACE(lesion_value, group, task, PROBE_LT), 
+	                   TRACE(lesion_value, group, task, PROBE_LR), threshold, m);
+	     TOTAL_ACT_LT[lesion_value][group][task] = m[0].total;
+	     TOTAL_ACT_LR[lesion_value][group][task] = m[1].total;
+
+	     trace_metrics(TRACE(lesion_value, group, task, PROBE_ST), 
+	                   TRACE(lesion_value, group, task, PROBE_SR), threshold, m);
+	     TOTAL_ACT_ST[lesion_value][group][task] = m[0].total;
+	     TOTAL_ACT_SR[lesion_value][group][task] = m[1].total;
+
+	     MEAN_ACT_C[lesion_value][group][task] 
+		   = (TOTAL_ACT_C[lesion_value][group][task] / N_STEPs);
+	     MEAN_ACT_S[lesion_value][group][task] 
+		   = (TOTAL_ACT_S[lesion_value][group][task] / N_STEPs);
+	     MEAN_ACT_CT[lesion_value][group][task] 
+		   = (TOTAL_ACT_CT[lesion_value][group][task] / N_STEPs);
+	     MEAN_ACT_CR[lesion_value][group][task] 
+		   = (TOTAL_ACT_CR[lesion_value][group][task] / N_STEPs);
+	     MEAN_ACT_LT[lesion_value][group][task] 
+		   = (TOTAL_ACT_LT[lesion_value][group][task] / N_STEPs);
+	     MEAN_ACT_LR[lesion_value][group][task] 
+		   = (TOTAL_ACT_LR[lesion_value][group][task] / N_STEPs);
+	     MEAN_ACT_ST[lesion_value][group][task] 
+		   = (TOTAL_ACT_ST[lesion_value][group][task] / N_STEPs);
+	     MEAN_ACT_SR[lesion_value][group][task] 
+		   = (TOTAL_ACT_SR[lesion_value][group][task] / N_STEPs);
+
+	     for (i = 0; i < N_LEVELs * N_ERROR_TYPEs; i++)
+		   MEAN_ACT_TYPE[lesion_value][group][task][i / N_ERROR_TYPEs][i % N_ERROR_TYPEs]
+		     = (TOTAL_ACT_TYPE[lesion_value][group][task][i / N_ERROR_TYPEs][i % N_ERROR_TYPEs] / N_STEPs);
+  
+	   }
+}
+
+
+/* 
+   Metrics of a target and a relative time series and of their difference 
+   (target minus relative), m[0], m[1] and m[2], in one pass over the two 
+   contiguous series. Activation recorded at step s is that at the end of 
+   the step, (s + 1) * STEP_SIZE ms; the area under the curve starts from 
+   zero activation at 0 ms. The totals are summed in time order, as the 
+   means always were.
+*/
+
+void trace_metrics(const double *target, const double *relative, double threshold, TRACE_METRICS m[3])
+{
+	double x[3], previous[3] = { 0.0, 0.0, 0.0 };
+	int s, k, in_window;
+
+	for (k = 0; k < 3; k++) {
+		m[k].total = m[k].window_total = m[k].auc = 0.0;
+		m[k].peak = -DBL_MAX;
+		m[k].peak_step = m[k].threshold_step = -1;
+		m[k].n_window = 0;
+	}
+
+	for (s = 0; s < N_STEPs; s++) {
+		x[0] = target[s];
+		x[1] = relative[s];
+		x[2] = x[0] - x[1];
+		in_window = ((s + 1) * STEP_SIZE > WINDOW_START && (s + 1) * STEP_SIZE <= WINDOW_END);
+
+		for (k = 0; k < 3; k++) {
+			m[k].total += x[k];
+			if (in_window) {
+				m[k].window_total += x[k];
+				m[k].n_window++;
+			}
+			m[k].auc += 0.5 * (previous[k] + x[k]) * STEP_SIZE;
+			if (x[k] > m[k].peak) {
+				m[k].peak = x[k];
+				m[k].peak_step = s;
+			}
+			if (m[k].threshold_step < 0 && x[k] >= threshold)
+				m[k].threshold_step = s;
+			previous[k] = x[k];
+		}
+	}
+}
+
+
+/* time course of the scored target and relative at lesion value a */
+
+void print_trajectory_metrics(int a)
+{
+	char *task_name[N_TASKs] = { "Naming", "Comprehension", "Repetition" };
+	char *series[3] = { "target", "relative", "difference" };
+	TRACE_METRICS m[3];
+	int t, k, level;
+
+	printf("Time course      window mean     AUC    peak  to peak  to threshold [ms]\n");
+	for (t = 0; t < N_TASKs; t++) {
+		level = RESPONSE_LEVEL[t];
+		if (level == CONCEPT_LEVEL)
+			trace_metrics(TRACE(a, group, t, PROBE_CT), TRACE(a, group, t, PROBE_CR), 
+			              SELECTION_THRESHOLD[level], m);
+		else
+			trace_metrics(TRACE(a, group, t, PROBE_ST), TRACE(a, group, t, PROBE_SR), 
+			              SELECTION_THRESHOLD[level], m);
+
+		for (k = 0; k < 3; k++) {
+			printf("%-13s %-10s %6.3f  %7.1f  %6.3f  %5d", k == 0 ? task_name[t] : "", series[k],
+				m[k].n_window ? m[k].window_total / m[k].n_window : 0.0, m[k].auc, m[k].peak, 
+				(m[k].peak_step + 1) * STEP_SIZE);
+			if (m[k].threshold_step >= 0)
+				printf("  %5d\n", (m[k].threshold_step + 1) * STEP_SIZE);
+			else
+				printf("      -\n");
+		}
+	}
+}
+
+
+
+
+/****************************
+ * TRAJECTORY PREFIX SUMS   *
+ ****************************/
+
+/*
+   The trajectory store saved as running sums: for every lesion value, group, 
+   task and probe, P[0] = 0 and P[k] is the summed activation of steps 0 to 
+   k - 1. The summed activation in any window (a, b] ms is then 
+   P[b / STEP_SIZE] - P[a / STEP_SIZE], so window means and integrals of a 
+   saved run are answered in constant time, without simulating again. The 
+   sums are built in time order, as the totals are, so the full window gives 
+   the means of the run exactly. The file holds a PREFIX_HEADER, the lesion 
+   values and then the sums, [lesion value][group][task][probe][N_STEPs + 1].
+*/
+
+void get_prefix_header(PREFIX_HEADER *h)
+{
+	memset(h, 0, sizeof(*h));
+	memcpy(h->magic, "WPPPSUM", 8);
+	h->n_values = N_lesion_values;
+	h->n_steps = N_STEPs;
+	h->step_size = STEP_SIZE;
+	h->n_groups = N_GROUPs;
+	h->n_tasks = N_TASKs;
+	h->n_probes = N_PROBEs;
+	h->weight_lesion = WEIGHT_LESION;
+}
+
+
+/* writes the prefix sums of the trajectory store, one series at a time; 0 if that fails */
+
+int save_prefix_sums(const char *file)
+{
+	PREFIX_HEADER h;
+	FILE *fp;
+	double *prefix;
+	const double *x;
+	int lv, g, t, p, s, ok;
+
+	if ((fp = fopen(file, "wb")) == NULL || (prefix = malloc(sizeof(double) * (N_STEPs + 1))) == NULL) {
+		fprintf(stderr, "cannot write %s\n", file);
+		if (fp != NULL)
+			fclose(fp);
+		return 0;
+	}
+
+	get_prefix_header(&h);
+	ok = (fwrite(&h, sizeof(h), 1, fp) == 1
+	      && fwrite(WEIGHT_LESION ? WEIGHT_value : DECAY_value, sizeof(double), N_lesion_values, fp) 
+	         == (size_t) N_lesion_values);
+
+	for (lv = 0; ok && lv < N_lesion_values; lv++)
+		for (g = 0; ok && g < N_GROUPs; g++)
+			for (t = 0; ok && t < N_TASKs; t++)
+				for (p = 0; ok && p < N_PROBEs; p++) {
+					x = TRACE(lv, g, t, p);
+					for (prefix[0] = 0.0, s = 0; s < N_STEPs; s++)
+						prefix[s + 1] = prefix[s] + x[s];
+					ok = (fwrite(prefix, sizeof(double), N_STEPs + 1, fp) == (size_t) (N_STEPs + 1));
+				}
+
+	free(prefix);
+	if (fclose(fp) != 0 || !ok) {
+		fprintf(stderr, "cannot write %s\n", file);
+		return 0;
+	}
+	return 1;
+}
+
+
+/* the steps a to b - 1 that end in the window (start, end] ms, and their number */
+
+int window_steps(int n_steps, int start, int end, int *a, int *b)
+{
+	*a = (start < 0 ? 0 : start / STEP_SIZE);
+	*b = (end < 0 ? 0 : end / STEP_SIZE);
+	*a = (*a > n_steps ? n_steps : *a);
+	*b = (*b > n_steps ? n_steps : *b);
+	return (*b > *a ? *b - *a : 0);
+}
+
+
+/* summed activation of a series in the window (start, end] ms */
+
+double window_sum(const double *prefix, int n_steps, int start, int end)
+{
+	int a, b;
+
+	return (window_steps(n_steps, start, end, &a, &b) > 0 ? prefix[b] - prefix[a] : 0.0);
+}
+
+
+/* 
+   Scores of group g at lesion value lv from the window means, as in the 
+   fits: target minus relative relative to the normal group.
+*/
+
+void window_scores(const double *prefix, const PREFIX_HEADER *h, int lv, int g, 
+	int start, int end, double score[N_TASKs])
+{
+	size_t n = h->n_steps + 1;
+	const double *trial;
+	double difference[2][N_TASKs]; /* of group g and of the normal group */
+	int t, i;
+
+	/* the number of steps in the window cancels in the ratio */
+	for (i = 0; i < 2; i++)
+		for (t = 0; t < N_TASKs; t++) {
+			trial = prefix + (((size_t) lv * N_GROUPs + (i == 0 ? g : NORMAL)) * N_TASKs + t) * N_PROBEs * n;
+			if (t == COMPREHENSION)
+				difference[i][t] = window_sum(trial + PROBE_CT * n, h->n_steps, start, end)
+				                 - window_sum(trial + PROBE_CR * n, h->n_steps, start, end);
+			else
+				difference[i][t] = window_sum(trial + PROBE_ST * n, h->n_steps, start, end)
+				                 - window_sum(trial + PROBE_SR * n, h->n_steps, start, end);
+		}
+
+	for (t = 0; t < N_TASKs; t++)
+		score[t] = difference[0][t] / difference[1][t] * 100.0;
+}
+
+
+/* 
+   Reads windows "start end" in ms from stdin and prints, per group, the 
+   best-fit lesion value and MAE against the PREFIX_ASSESSMENT data from 
+   the saved run, with the scores at that value.
+*/
+
+int query_prefix_sums()
+{
+	char *name[N_GROUPs] = { "Normal", "Nonfluent/agrammatic", "Semantic", "Logopenic" };
+	PREFIX_HEADER h, expected;
+	const double *value, *prefix;
+	double score[N_TASKs], best_score[N_TASKs] = { 0.0 }, error, best, start_time;
+	char *data, line[256];
+	size_t size;
+	int start, end, g, lv, best_lv, a, b;
+
+	if ((data = map_file(PREFIX_FILE, &size)) == NULL) {
+		fprintf(stderr, "cannot read %s, run with SAVE_PREFIX_SUMS first\n", PREFIX_FILE);
+		return 1;
+	}
+	memcpy(&h, data, sizeof(h) <= size ? sizeof(h) : size);
+	get_prefix_header(&expected);
+	if (size < sizeof(h) || memcmp(h.magic, expected.magic, 8) != 0 || h.step_size != STEP_SIZE 
+		|| h.n_groups != N_GROUPs || h.n_tasks != N_TASKs || h.n_probes != N_PROBEs 
+		|| h.n_values < 1 || h.n_steps < 1 
+		|| size != sizeof(h) + sizeof(double) * ((size_t) h.n_values 
+		           + (size_t) h.n_values * N_GROUPs * N_TASKs * N_PROBEs * (h.n_steps + 1))) {
+		fprintf(stderr, "%s does not fit this program\n", PREFIX_FILE);
+		unmap_file(data, size);
+		return 1;
+	}
+	value = (const double *) (data + sizeof(h));
+	prefix = value + h.n_values;
+
+	assessment = PREFIX_ASSESSMENT;
+	set_real_data_matrix();
+
+	printf("%s: %d %s values, %d steps of %d ms\n", PREFIX_FILE, h.n_values, 
+		h.weight_lesion ? "weight" : "decay", h.n_steps, h.step_size);
+	printf("windows as \"<start> <end>\" in ms, the window is (start, end]\n");
+	fflush(stdout);
+
+	while (fgets(line, sizeof(line), stdin) != NULL) {
+		if (sscanf(line, "%d %d", &start, &end) != 2) {
+			if (strncmp(line, "quit", 4) == 0)
+				break;
+			printf("error: expected <start> <end>\n");
+			fflush(stdout);
+			continue;
+		}
+		if (window_steps(h.n_steps, start, end, &a, &b) == 0) {
+			printf("error: the window must hold the end of a step, %d ms to %d ms\n", 
+				h.step_size, h.n_steps * h.step_size);
+			fflush(stdout);
+			continue;
+		}
+		start_time = wall_time();
+
+		/* the window of the steps used, cut to the run and to whole steps */
+		printf("\nWindow (%d, %d] ms", a * h.step_size, b * h.step_size);
+		if (a * h.step_size != start || b * h.step_size != end)
+			printf(", cut from (%d, %d] to the run and to whole steps", start, end);
+		printf("\n");
+		for (g = NONFLUENT_AGRAMMATIC; g <= LOGOPENIC; g++) {
+			for (best = DBL_MAX, best_lv = -1, lv = 0; lv < h.n_values; lv++) {
+				window_scores(prefix, &h, lv, g, start, end, score);
+				error = (fabs(REAL_DATA[g][NAMING] - score[NAMING])
+				       + fabs(REAL_DATA[g][COMPREHENSION] - score[COMPREHENSION])
+				       + fabs(REAL_DATA[g][REPETITION] - score[REPETITION])) / 3.0;
+				if (error < best) {
+					best = error;
+					best_lv = lv;
+					memcpy(best_score, score, sizeof(score));
+				}
+			}
+			/* no error is a number when the normal group has no difference yet */
+			if (best_lv < 0) {
+				printf("%-22s no fit, the normal group shows no difference in this window\n", name[g]);
+				continue;
+			}
+			printf("%-22s value = %.2f   MAE = %.2f   Sim N C R = %.0f %.0f %.0f\n", name[g], 
+				value[best_lv], best, best_score[NAMING], best_score[COMPREHENSION], best_score[REPETITION]);
+		}
+		printf("answered in %.1f microseconds\n", (wall_time() - start_time) * 1e6);
+		fflush(stdout);
+	}
+
+	unmap_file(data, size);
+	return 0;
+}
+
+
+
+
+/**************
+ * PROBE SETS *
+ **************/
+
+/* the nodes of a layer, and their number */
+
+double *layer_nodes(LAYERS *x, int layer, int *n)
+{
+	switch (layer) {
+	case C_LAYER: *n = N_CONCEPTs; return x->C;
+	case L_LAYER: *n = N_LEMMAs; return x->L;
+	case M_LAYER: *n = N_MORPHEMEs; return x->M;
+	case oP_LAYER: *n = N_PHONEMEs; return x->oP;
+	case iP_LAYER: *n = N_PHONEMEs; return x->iP;
+	case iM_LAYER: *n = N_MORPHEMEs; return x->iM;
+	default: *n = N_SYLLABLEs; return x->S;
+	}
+}
+
+
+char *LAYER_NAME[N_LAYERs] = { "C", "L", "M", "oP", "iP", "iM", "S" };
+char *WORD_NAME[N_CONCEPTs] = { "CAT", "DOG", "MAT", "FOG", "FISH" };
+char *PHONEME_NAME[N_PHONEMEs] = { "k", "e", "t", "d", "o", "g", "m", "f", "i", "s" };
+
+
+/*
+   Reads a probe specification: probes separated by spaces or commas, each 
+   <layer>[.<node>][:<stride>], e.g. "C.FISH iP:4 S.2". A layer is one of 
+   C, L, M, oP, iP, iM and S; without a node, all nodes of the layer are 
+   probed. A node is given by its word (CAT ... FISH), its phoneme (k ... s) 
+   or its index. The stride is in steps, 1 by default; a probe records the 
+   steps 0, stride, 2 * stride, ... Sets the sizes of the probe record; 0 
+   if the specification is wrong.
+*/
+
+int parse_probes(const char *spec)
+{
+	char item[64], layer[8], node[16];
+	PROBE *p;
+	int i, n, used, n_nodes, stride, found;
+
+	N_EXTRA_PROBEs = 0;
+	PROBE_RECORD_SIZE = 0;
+
+	while (sscanf(spec, " %63[^ ,]%n", item, &used) == 1) {
+		spec += used;
+		while (*spec == ' ' || *spec == ',')
+			spec++;
+
+		node[0] = '\0';
+		stride = 1;
+		if (sscanf(item, "%7[^.:]%n", layer, &n) != 1
+			|| (item[n] == '.' && sscanf(item + n + 1, "%15[^:]%n", node, &used) != 1)) {
+			fprintf(stderr, "probe %s: expected <layer>[.<node>][:<stride>]\n", item);
+			return 0;
+		}
+		if (item[n] == '.')
+			n += 1 + used;
+		if ((item[n] == ':' && (sscanf(item + n + 1, "%d", &stride) != 1 || stride < 1)) 
+			|| (item[n] != ':' && item[n] != '\0')) {
+			fprintf(stderr, "probe %s: the stride must be a positive number of steps\n", item);
+			return 0;
+		}
+		if (N_EXTRA_PROBEs == N_MAX_EXTRA_PROBEs) {
+			fprintf(stderr, "at most %d probes\n", N_MAX_EXTRA_PROBEs);
+			return 0;
+		}
+
+		p = &EXTRA_PROBE[N_EXTRA_PROBEs];
+		for (p->layer = 0; p->layer < N_LAYERs && strcmp(layer, LAYER_NAME[p->layer]) != 0; p->layer++)
+			;
+		if (p->layer == N_LAYERs) {
+			fprintf(stderr, "probe %s: unknown layer %s\n", item, layer);
+			return 0;
+		}
+		layer_nodes(&node_act, p->layer, &n_nodes);
+
+		if (node[0] == '\0') {
+			p->first = 0;
+			p->n = n_nodes;
+		} else {
+			found = (sscanf(node, "%d%n", &p->first, &used) == 1 && node[used] == '\0');
+			for (i = 0; !found && i < n_nodes; i++)
+				if (strcmp(node, n_nodes == N_PHONEMEs ? PHONEME_NAME[i] : WORD_NAME[i]) == 0) {
+					p->first = i;
+					found = 1;
+				}
+			if (!found || p->first < 0 || p->first >= n_nodes) {
+				fprintf(stderr, "probe %s: unknown node %s\n", item, node);
+				return 0;
+			}
+			p->n = 1;
+		}
+
+		p->stride = stride;
+		p->n_samples = (N_STEPs + stride - 1) / stride;
+		p->offset = PROBE_RECORD_SIZE;
+		PROBE_RECORD_SIZE += (size_t) p->n * p->n_samples;
+		N_EXTRA_PROBEs++;
+	}
+
+	return 1;
+}
+
+
+/* the samples of the further probes due at this step */
+
+void record_probes()
+{
+	double *record = PROBE_RECORD + (((size_t) lesion_value * N_GROUPs + group) * N_TASKs + task) * PROBE_RECORD_SIZE;
+	const double *x;
+	PROBE *p;
+	int i, n;
+
+	for (p = EXTRA_PROBE; p < EXTRA_PROBE + N_EXTRA_PROBEs; p++)
+		if (step % p->stride == 0) {
+			x = layer_nodes(&node_act, p->layer, &n) + p->first;
+			for (i = 0; i < p->n; i++)
+				record[p->offset + (size_t) i * p->n_samples + step / p->stride] = x[i];
+		}
+}
+
+
+/* 
+   Writes the samples of the further probes as one row per sample: lesion 
+   value, group, task, node, time and activation. The time of step s is 
+   that at its end, (s + 1) * STEP_SIZE ms, as in the trajectory store.
+*/
+
+int write_probes(const char *file)
+{
+	char *group_name[N_GROUPs] = { "Normal", "Nonfluent/agrammatic", "Semantic", "Logopenic" };
+	char *task_name[N_TASKs] = { "Naming", "Comprehension", "Repetition" };
+	const double *record, *value = (WEIGHT_LESION ? WEIGHT_value : DECAY_value);
+	FILE *fp;
+	PROBE *p;
+	int lv, g, t, i, k, n_nodes;
+
+	if ((fp = fopen(file, "w")) == NULL) {
+		fprintf(stderr, "cannot write %s\n", file);
+		return 0;
+	}
+
+	fprintf(fp, "lesion_value,group,task,node,time_ms,activation\n");
+	for (lv = 0; lv < N_lesion_values; lv++)
+		for (g = 0; g < N_GROUPs; g++)
+			for (t = 0; t < N_TASKs; t++) {
+				record = PROBE_RECORD + (((size_t) lv * N_GROUPs + g) * N_TASKs + t) * PROBE_RECORD_SIZE;
+				for (p = EXTRA_PROBE; p < EXTRA_PROBE + N_EXTRA_PROBEs; p++) {
+					layer_nodes(&node_act, p->layer, &n_nodes);
+					for (i = 0; i < p->n; i++)
+						for (k = 0; k < p->n_samples; k++)
+							fprintf(fp, "%.4f,%s,%s,%s.%s,%d,%.6f\n", value[lv], group_name[g], 
+								task_name[t], LAYER_NAME[p->layer], 
+								n_nodes == N_PHONEMEs ? PHONEME_NAME[p->first + i] : WORD_NAME[p->first + i],
+								(k * p->stride + 1) * STEP_SIZE, 
+								record[p->offset + (size_t) i * p->n_samples + k]);
+				}
+			}
+
+	if (fclose(fp) != 0) {
+		fprintf(stderr, "cannot write %s\n", file);
+		return 0;
+	}
+	return 1;
+}
+
+
+
+
+/***************
+ * LIVE STREAM *
+ ***************/
+
+/*
+   With LIVE_STREAM set, every step of the stepped simulation publishes the 
+   activation of the probes of the trajectory store into a ring of 
+   N_LIVE_SLOTs samples in POSIX shared memory, LIVE_STREAM_NAME (under 
+   /dev/shm on Linux). A viewer maps it read-only and follows it without 
+   locks and without the simulation ever waiting: sample n goes into slot 
+   n % N_LIVE_SLOTs, whose sequence is 0 while it is written and n + 1 once 
+   it is complete, after which the published count is raised. A viewer 
+   copies a slot and keeps the copy if the sequence was n + 1 before and 
+   after; a viewer that falls more than a ring behind skips ahead. The 
+   layout is that of LIVE_RING, so e.g. numpy can read it as a record 
+   array. Publishing a sample costs a few stores per step. Not available 
+   on Windows.
+*/
+
+#ifdef LIVE_SHM
+LIVE_RING *LIVE;
+#endif
+
+
+/* creates or reuses the shared memory; 0 if that fails */
+
+int open_live_stream()
+{
+#ifdef LIVE_SHM
+	int fd;
+
+	if ((fd = shm_open(LIVE_STREAM_NAME, O_CREAT | O_RDWR, 0644)) < 0 
+		|| ftruncate(fd, sizeof(LIVE_RING)) != 0) {
+		fprintf(stderr, "cannot create the shared memory %s\n", LIVE_STREAM_NAME);
+		if (fd >= 0)
+			close(fd);
+		return 0;
+	}
+	LIVE = mmap(NULL, sizeof(LIVE_RING), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (LIVE == MAP_FAILED) {
+		fprintf(stderr, "cannot map the shared memory %s\n", LIVE_STREAM_NAME);
+		return 0;
+	}
+
+	/* a new run starts counting again, which a viewer takes as a restart */
+	atomic_store(&LIVE->published, 0);
+	memcpy(LIVE->magic, "WPPLIVE", 8);
+	LIVE->n_slots = N_LIVE_SLOTs;
+	LIVE->n_probes = N_PROBEs;
+	LIVE->step_size = STEP_SIZE;
+	LIVE->sample_size = sizeof(LIVE_SAMPLE);
+	return 1;
+#else
+	fprintf(stderr, "the live stream needs POSIX shared memory\n");
+	return 0;
+#endif
+}
+
+
+/* the probes of the current step, as in determine_activation_critical_nodes() */
+
+void publish_live_sample()
+{
+#ifdef LIVE_SHM
+	unsigned long long n = atomic_load_explicit(&LIVE->published, memory_order_relaxed);
+	LIVE_SAMPLE *x = &LIVE->sample[n & (N_LIVE_SLOTs - 1)];
+	int p;
+
+	atomic_store_explicit(&x->sequence, 0, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	x->lesion_value = lesion_value;
+	x->group = group;
+	x->task = task;
+	x->step = step;
+	x->value = (WEIGHT_LESION ? WEIGHT_value[lesion_value] : DECAY_value[lesion_value]);
+	for (p = 0; p < N_PROBEs; p++)
+		x->act[p] = TRACE(lesion_value, group, task, p)[step];
+	atomic_store_explicit(&x->sequence, n + 1, memory_order_release);
+	atomic_store_explicit(&LIVE->published, n + 1, memory_order_release);
+#endif
+}
+
+
+/* 
+   The viewer: prints the samples of a running simulation as they come, 
+   one line each, until it is interrupted.
+*/
+
+int watch_live_stream()
+{
+#ifdef LIVE_SHM
+	char *group_name[N_GROUPs] = { "Normal", "NFA", "Semantic", "Logopenic" };
+	char *task_name[N_TASKs] = { "Naming", "Comprehension", "Repetition" };
+	const LIVE_RING *ring;
+	LIVE_SAMPLE x;
+	unsigned long long next = 0, published, sequence;
+	struct timespec pause = { 0, 10000000 }; /* 10 ms */
+	int fd, p;
+
+	if ((fd = shm_open(LIVE_STREAM_NAME, O_RDONLY, 0)) < 0) {
+		fprintf(stderr, "no live stream %s, run the simulation with LIVE_STREAM set\n", LIVE_STREAM_NAME);
+		return 1;
+	}
+	ring = mmap(NULL, sizeof(LIVE_RING), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (ring == MAP_FAILED || memcmp(ring->magic, "WPPLIVE", 8) != 0 || ring->n_slots != N_LIVE_SLOTs 
+		|| ring->n_probes != N_PROBEs || ring->sample_size != (int) sizeof(LIVE_SAMPLE)) {
+		fprintf(stderr, "%s does not fit this program\n", LIVE_STREAM_NAME);
+		return 1;
+	}
+
+	printf("value  group      task           ms      C      S     CT     CR     LT     LR     ST     SR\n");
+	for (;;) {
+		published = atomic_load_explicit((atomic_ullong *) &ring->published, memory_order_acquire);
+		if (published < next) /* a new run */
+			next = 0;
+		if (published - next > N_LIVE_SLOTs) {
+			printf("(skipped %llu samples)\n", published - N_LIVE_SLOTs - next);
+			next = published - N_LIVE_SLOTs;
+		}
+		if (next == published) {
+			fflush(stdout);
+			nanosleep(&pause, NULL);
+			continue;
+		}
+
+		for (; next < published; next++) {
+			const LIVE_SAMPLE *slot = &ring->sample[next & (N_LIVE_SLOTs - 1)];
+
+			sequence = atomic_load_explicit((atomic_ullong *) &slot->sequence, memory_order_acquire);
+			memcpy(&x, slot, sizeof(x));
+			atomic_thread_fence(memory_order_acquire);
+			if (sequence != next + 1 
+				|| atomic_load_explicit((atomic_ullong *) &slot->sequence, memory_order_relaxed) != sequence)
+				continue; /* overwritten meanwhile */
+
+			printf("%.4f %-10s %-13s %5d", x.value, group_name[x.group], task_name[x.task], 
+				(x.step + 1) * ring->step_size);
+			for (p = 0; p < N_PROBEs; p++)
+				printf(" %6.3f", x.act[p]);
+			printf("\n");
+		}
+	}
+#else
+	fprintf(stderr, "the live stream needs POSIX shared memory\n");
+	return 1;
+#endif
+}
+
+
+
+
+/*********************
+ * STUDY DEFINITIONS *
+ *********************/
+
+/*
+   All studies from one definition file, instead of a program per study. 
+   The file holds, one item per line ('#' starts a comment):
+
+     site <name> [blocks <block> ...] [layers <layer> ...]
+         a lesion site: the connection blocks a weight lesion scales 
+         (Pic CC LC CL iML LM iMM MP iPoP PS oPiP PiM) and the layers 
+         whose decay a decay lesion raises (C L M oP iP iM S)
+     network <CC | CL | LM | MP | PS | PP | PiM | iMM | iML>
+         followed by the rows of that connection table, replacing the 
+         built-in one (same size; the network sizes are fixed)
+     study <title>
+     case <label> <site> <naming> <comprehension> <repetition>
+         a patient or group of the last study, lesioned at the site
+
+   All cases are fitted in one run: every site that a case uses is swept 
+   over all lesion values once, in parallel (with OpenMP), and the scores 
+   are shared by the cases of all studies, which are then fitted against 
+   them as in the global fit of the rates.
+*/
+
+#define N_MAX_DEFINED_SITEs 16
+#define N_MAX_DEFINED_STUDIEs 32
+#define N_MAX_DEFINED_CASEs 1024
+
+char *BLOCK_NAME[N_BLOCKs] = { "Pic", "CC", "LC", "CL", "iML", "LM", "iMM", "MP", "iPoP", "PS", "oPiP", "PiM" };
+
+/* the sites of the variants in STUDY_FILE */
+char *VARIANT_SITE_NAME[N_GROUPs] = { "", "nfa", "sem", "log" };
+
+char DEFINED_SITE_NAME[N_MAX_DEFINED_SITEs][32];
+int DEFINED_SITE_BLOCKS[N_MAX_DEFINED_SITEs][N_BLOCKs];
+int DEFINED_SITE_LAYERS[N_MAX_DEFINED_SITEs][N_LAYERs];
+int N_DEFINED_SITEs = 0;
+
+char DEFINED_STUDY_TITLE[N_MAX_DEFINED_STUDIEs][128];
+int N_DEFINED_STUDIEs = 0;
+
+char DEFINED_CASE_LABEL[N_MAX_DEFINED_CASEs][32];
+int DEFINED_CASE_STUDY[N_MAX_DEFINED_CASEs];
+int DEFINED_CASE_SITE[N_MAX_DEFINED_CASEs];
+double DEFINED_CASE_DATA[N_MAX_DEFINED_CASEs][N_TASKs];
+int N_DEFINED_CASEs = 0;
+
+
+/* index of a word in a list of names, -1 if it is not there */
+
+int find_name(char *name[], int n, const char *word)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		if (strcmp(name[i], word) == 0)
+			return i;
+	return -1;
+}
+
+
+/* 0 if the file cannot be read or has an error, which is reported */
+
+int read_study_definitions(const char *file)
+{
+	char *table_name[] = { "CC", "CL", "LM", "MP", "PS", "PP", "PiM", "iMM", "iML" };
+	double *table[] = { &CC_con[0][0], &CL_con[0][0], &LM_con[0][0], &MP_con[0][0], &PS_con[0][0], 
+	                    &PP_con[0][0], &PiM_con[0][0], &iMM_con[0][0], &iML_con[0][0] };
+	int n_rows[] = { N_CONCEPTs, N_CONCEPTs, N_LEMMAs, N_MORPHEMEs, N_PHONEMEs, 
+	                 N_PHONEMEs, N_PHONEMEs, N_MORPHEMEs, N_MORPHEMEs };
+	int n_columns[] = { N_CONCEPTs, N_LEMMAs, N_MORPHEMEs, N_PHONEMEs, N_SYLLABLEs, 
+	                    N_PHONEMEs, N_MORPHEMEs, N_MORPHEMEs, N_LEMMAs };
+	char line[512], *word, *rest, *end;
+	const char *error = NULL;
+	FILE *fp;
+	int line_number = 0, k, i, j, row = 0, n = -1, list = 0, t;
+
+	if ((fp = fopen(file, "r")) == NULL) {
+		fprintf(stderr, "cannot read %s\n", file);
+		return 0;
+	}
+
+	while (error == NULL && fgets(line, sizeof(line), fp) != NULL) {
+		line_number++;
+		if ((word = strchr(line, '#')) != NULL)
+			*word = '\0';
+		if ((word = strtok(line, " \t\r\n")) == NULL)
+			continue;
+
+		/* the rows of a connection table */
+		if (n >= 0) {
+			for (j = 0; j < n_columns[n] && word != NULL; j++, word = strtok(NULL, " \t\r\n")) {
+				table[n][row * n_columns[n] + j] = strtod(word, &end);
+				if (*end != '\0')
+					error = "a connection must be a number";
+			}
+			if (j < n_columns[n] || word != NULL)
+				error = "a row of the table has the wrong number of connections";
+			if (++row == n_rows[n])
+				n = -1;
+		}
+
+		else if (strcmp(word, "site") == 0) {
+			if (N_DEFINED_SITEs == N_MAX_DEFINED_SITEs)
+				error = "too many sites";
+			else if ((word = strtok(NULL, " \t\r\n")) == NULL)
+				error = "a site needs a name";
+			else {
+				k = N_DEFINED_SITEs++;
+				snprintf(DEFINED_SITE_NAME[k], sizeof(DEFINED_SITE_NAME[k]), "%s", word);
+				for (list = 0; error == NULL && (word = strtok(NULL, " \t\r\n")) != NULL; )
+					if (strcmp(word, "blocks") == 0 || strcmp(word, "layers") == 0)
+						list = word[0];
+					else if (list == 'b' && (i = find_name(BLOCK_NAME, N_BLOCKs, word)) >= 0)
+						DEFINED_SITE_BLOCKS[k][i] = 1;
+					else if (list == 'l' && (i = find_name(LAYER_NAME, N_LAYERs, word)) >= 0)
+						DEFINED_SITE_LAYERS[k][i] = 1;
+					else
+						error = "expected blocks or layers, and known names";
+			}
+		}
+
+		else if (strcmp(word, "network") == 0) {
+			if ((word = strtok(NULL, " \t\r\n")) == NULL 
+				|| (n = find_name(table_name, sizeof(table_name) / sizeof(table_name[0]), word)) < 0)
+				error = "unknown connection table";
+			row = 0;
+		}
+
+		else if (strcmp(word, "study") == 0) {
+			if ((rest = strtok(NULL, "\r\n")) == NULL)
+				error = "a study needs a title";
+			else if (N_DEFINED_STUDIEs == N_MAX_DEFINED_STUDIEs)
+				error = "too many studies";
+			else {
+				while (*rest == ' ' || *rest == '\t')
+					rest++;
+				snprintf(DEFINED_STUDY_TITLE[N_DEFINED_STUDIEs], sizeof(DEFINED_STUDY_TITLE[0]), "%s", rest);
+				N_DEFINED_STUDIEs++;
+			}
+		}
+
+		else if (strcmp(word, "case") == 0) {
+			k = N_DEFINED_CASEs;
+			if (N_DEFINED_STUDIEs == 0)
+				error = "a case before the first study";
+			else if (k == N_MAX_DEFINED_CASEs)
+				error = "too many cases";
+			else if ((word = strtok(NULL, " \t\r\n")) == NULL)
+				error = "a case needs a label";
+			else {
+				snprintf(DEFINED_CASE_LABEL[k], sizeof(DEFINED_CASE_LABEL[k]), "%s", word);
+				DEFINED_CASE_STUDY[k] = N_DEFINED_STUDIEs - 1;
+				if ((word = strtok(NULL, " \t\r\n")) == NULL)
+					error = "a case needs a site";
+				for (i = 0; error == NULL && i < N_DEFINED_SITEs; i++)
+					if (strcmp(word, DEFINED_SITE_NAME[i]) == 0)
+						break;
+				if (error == NULL && (DEFINED_CASE_SITE[k] = i) == N_DEFINED_SITEs)
+					error = "unknown site, define it first";
+				for (t = 0; error == NULL && t < N_TASKs; t++)
+					if ((word = strtok(NULL, " \t\r\n")) == NULL 
+						|| (DEFINED_CASE_DATA[k][t] = strtod(word, &end), *end != '\0'))
+						error = "a case needs naming, comprehension and repetition scores";
+				if (error == NULL && strtok(NULL, " \t\r\n") != NULL)
+					error = "a case has more than three scores";
+				N_DEFINED_CASEs++;
+			}
+		}
+
+		else
+			error = "expected site, network, study or case";
+	}
+	fclose(fp);
+
+	if (error == NULL && n >= 0)
+		error = "the file ends within a connection table";
+	if (error != NULL) {
+		fprintf(stderr, "%s:%d: %s\n", file, line_number, error);
+		return 0;
+	}
+
+	N_CACHED_WEIGHT_SETs = 0; /* the network may have changed */
+	return 1;
+}
+
+
+/* 
+   The cases of the defined study with that title, lesioned at the named 
+   site: points data at their scores and returns their number, 0 if there 
+   are none. They must be listed together in the study.
+*/
+
+int study_cases(const char *title, const char *site, double (**data)[N_TASKs])
+{
+	int i, first = -1, n = 0;
+
+	*data = NULL;
+	for (i = 0; i < N_DEFINED_CASEs; i++)
+		if (strcmp(DEFINED_STUDY_TITLE[DEFINED_CASE_STUDY[i]], title) == 0 
+			&& strcmp(DEFINED_SITE_NAME[DEFINED_CASE_SITE[i]], site) == 0) {
+			if (first < 0)
+				first = i;
+			else if (i != first + n) {
+				fprintf(stderr, "%s: the %s cases of %s are not listed together\n", STUDY_FILE, site, title);
+				return 0;
+			}
+			n++;
+		}
+	if (n > 0)
+		*data = &DEFINED_CASE_DATA[first];
+	return n;
+}
+
+
+/* the Janssen et al. (2022) cases of a variant */
+
+int janssen_cases(int variant, double (**data)[N_TASKs])
+{
+	char *title[N_GROUPs] = { "", "Janssen et al. (2022), nonfluent/agrammatic cases", 
+	                          "Janssen et al. (2022), semantic cases", "Janssen et al. (2022), logopenic cases" };
+
+	return study_cases(title[variant], VARIANT_SITE_NAME[variant], data);
+}
+
+
+/* fits all cases of all studies; prints them per study */
+
+int run_studies()
+{
+	const char *type = (WEIGHT_LESION ? "weight" : "decay");
+	double (*score)[N_lesion_values][N_TASKs];
+	double rate[N_RATEs], normal[N_TASKs], target, relative, error, best, start, study_mae;
+	int used[N_MAX_DEFINED_SITEs] = { 0 }, job[N_MAX_DEFINED_SITEs], n_jobs = 0;
+	int i, j, a, lv, t, study, n;
+	WEIGHT_SET *w;
+
+	if ((score = malloc(sizeof(*score) * N_DEFINED_SITEs)) == NULL || (w = malloc(sizeof(*w))) == NULL) {
+		fprintf(stderr, "cannot allocate the score tables\n");
+		return 1;
+	}
+
+	for (i = 0; i < N_RATEs; i++)
+		rate[i] = *RATE_VARIABLE[i];
+	get_rate_configuration(&w->config, rate);
+	derive_weight_set(w);
+	for (t = 0; t < N_TASKs; t++) {
+		run_fit_trial(w, t, &target, &relative);
+		normal[t] = target - relative;
+	}
+	free(w);
+
+	for (i = 0; i < N_DEFINED_CASEs; i++)
+		used[DEFINED_CASE_SITE[i]] = 1;
+	for (i = 0; i < N_DEFINED_SITEs; i++)
+		if (used[i])
+			job[n_jobs++] = i;
+
+	/* every site once, for all studies */
+	start = wall_time();
+	#pragma omp parallel for schedule(dynamic)
+	for (j = 0; j < n_jobs * N_lesion_values; j++) {
+		WEIGHT_SET ws;
+		double x, y;
+		int site = job[j / N_lesion_values], v = j % N_lesion_values, k;
+
+		get_rate_configuration(&ws.config, rate);
+		add_lesion_at(&ws.config, DEFINED_SITE_BLOCKS[site], DEFINED_SITE_LAYERS[site], 
+			WEIGHT_LESION ? WEIGHT_value[v] : 1.0, DECAY_LESION ? DECAY_value[v] : 1.0);
+		derive_weight_set(&ws);
+		for (k = 0; k < N_TASKs; k++) {
+			run_fit_trial(&ws, k, &x, &y);
+			score[site][v][k] = (x - y) / normal[k] * 100.0;
+		}
+	}
+
+	printf("\n%d studies, %d cases, %d lesion sites swept in %.2f s\n", 
+		N_DEFINED_STUDIEs, N_DEFINED_CASEs, n_jobs, wall_time() - start);
+
+	for (study = 0; study < N_DEFINED_STUDIEs; study++) {
+		printf("\n%s\n", DEFINED_STUDY_TITLE[study]);
+		printf("Case         Site       Naming  Comprehension  Repetition   %s value   MAE\n", type);
+		for (study_mae = 0.0, n = 0, i = 0; i < N_DEFINED_CASEs; i++) {
+			if (DEFINED_CASE_STUDY[i] != study)
+				continue;
+			for (best = DBL_MAX, a = 0, lv = 0; lv < N_lesion_values; lv++) {
+				for (error = 0.0, t = 0; t < N_TASKs; t++)
+					error += fabs(DEFINED_CASE_DATA[i][t] - score[DEFINED_CASE_SITE[i]][lv][t]);
+				if (error / 3.0 < best) {
+					best = error / 3.0;
+					a = lv;
+				}
+			}
+			printf("%-12s %-10s %6.2f    %6.2f       %6.2f  real\n", DEFINED_CASE_LABEL[i], 
+				DEFINED_SITE_NAME[DEFINED_CASE_SITE[i]], DEFINED_CASE_DATA[i][NAMING], 
+				DEFINED_CASE_DATA[i][COMPREHENSION], DEFINED_CASE_DATA[i][REPETITION]);
+			printf("%-12s %-10s %6.2f    %6.2f       %6.2f  sim   %5.2f    %5.2f\n", "", "", 
+				score[DEFINED_CASE_SITE[i]][a][NAMING], score[DEFINED_CASE_SITE[i]][a][COMPREHENSION], 
+				score[DEFINED_CASE_SITE[i]][a][REPETITION], 
+				WEIGHT_LESION ? WEIGHT_value[a] : DECAY_value[a], best);
+			study_mae += best;
+			n++;
+		}
+		if (n > 0)
+			printf("Mean MAE = %.2f over %d cases\n", study_mae / n, n);
+	}
+
+	free(score);
+	return 0;
+}
+
+
+
+
+/******************
+ * NETWORK KERNEL *
+ ******************/
+
+/*
+   get_internal_input() loops over all pairs of nodes, but most connections 
+   of these small layers are absent. "<program> kernel" writes KERNEL_FILE, 
+   a version of it for the current network (the built-in one, or that of 
+   studies=), fully unrolled and without the absent connections. Compiled 
+   with -DNETWORK_KERNEL the program includes that file and uses it while 
+   the network has no connections the kernel lacks; otherwise, e.g. after 
+   a study file changed the network, the loops are used. The kernel adds 
+   the same products in the same order, so the results are identical.
+*/
+
+#define N_SPREAD_BLOCKs 11 /* weight matrices of WEIGHT_SET, in the order of get_internal_input() */
+
+/* receiving and sending layer, matrix, and its connection table [from][to] */
+char *SPREAD_TO[N_SPREAD_BLOCKs] = { "C", "C", "L", "L", "M", "M", "oP", "oP", "S", "iP", "iM" };
+char *SPREAD_FROM[N_SPREAD_BLOCKs] = { "C", "L", "C", "iM", "L", "iM", "M", "iP", "oP", "oP", "iP" };
+char *SPREAD_WEIGHT[N_SPREAD_BLOCKs] = { "CC", "LC", "CL", "iML", "LM", "iMM", "MP", "iPoP", "PS", "oPiP", "PiM" };
+double *SPREAD_CON[N_SPREAD_BLOCKs] = { &CC_con[0][0], &CL_con[0][0], &CL_con[0][0], &iML_con[0][0], 
+                                        &LM_con[0][0], &iMM_con[0][0], &MP_con[0][0], &PP_con[0][0], 
+                                        &PS_con[0][0], &PP_con[0][0], &PiM_con[0][0] };
+int SPREAD_N_TO[N_SPREAD_BLOCKs] = { N_CONCEPTs, N_CONCEPTs, N_LEMMAs, N_LEMMAs, N_MORPHEMEs, N_MORPHEMEs, 
+                                     N_PHONEMEs, N_PHONEMEs, N_SYLLABLEs, N_PHONEMEs, N_MORPHEMEs };
+int SPREAD_N_FROM[N_SPREAD_BLOCKs] = { N_CONCEPTs, N_LEMMAs, N_CONCEPTs, N_MORPHEMEs, N_LEMMAs, N_MORPHEMEs, 
+                                       N_MORPHEMEs, N_PHONEMEs, N_PHONEMEs, N_PHONEMEs, N_PHONEMEs };
+
+
+/* 0 if the file cannot be written */
+
+int write_network_kernel(const char *file)
+{
+	FILE *fp;
+	int b, i, j, n, n_present = 0;
+
+	if ((fp = fopen(file, "w")) == NULL) {
+		fprintf(stderr, "cannot write %s\n", file);
+		return 0;
+	}
+
+	fprintf(fp, "/* %s: get_internal_input() of one network, written by \"<program> kernel\" */\n\n", file);
+	fprintf(fp, "#if N_CONCEPTs != %d || N_LEMMAs != %d || N_MORPHEMEs != %d || N_PHONEMEs != %d || N_SYLLABLEs != %d\n", 
+		N_CONCEPTs, N_LEMMAs, N_MORPHEMEs, N_PHONEMEs, N_SYLLABLEs);
+	fprintf(fp, "#error \"%s is for another network size, write it again\"\n#endif\n\n", file);
+
+	/* the connections present, [to][from] per matrix */
+	fprintf(fp, "int KERNEL_LINKS[] = {");
+	for (b = 0, n = 0; b < N_SPREAD_BLOCKs; b++)
+		for (i = 0; i < SPREAD_N_TO[b]; i++)
+			for (j = 0; j < SPREAD_N_FROM[b]; j++, n++)
+				fprintf(fp, "%s%d", (n % 25 == 0 ? (n == 0 ? "\n\t" : ",\n\t") : ", "), 
+					SPREAD_CON[b][j * SPREAD_N_TO[b] + i] != 0.0);
+	fprintf(fp, "\n};\n\n");
+
+	fprintf(fp, "void kernel_internal_input(const LAYERS *act, LAYERS *input, const WEIGHT_SET *w)\n{\n");
+	for (b = 0; b < N_SPREAD_BLOCKs; b++) {
+		fprintf(fp, "\t/* %s, %s to %s */\n", SPREAD_WEIGHT[b], SPREAD_FROM[b], SPREAD_TO[b]);
+		for (i = 0; i < SPREAD_N_TO[b]; i++)
+			for (j = 0; j < SPREAD_N_FROM[b]; j++)
+				if (SPREAD_CON[b][j * SPREAD_N_TO[b] + i] != 0.0 && ++n_present)
+					fprintf(fp, "\tinput->%s[%d] += act->%s[%d] * w->%s[%d][%d];\n", 
+						SPREAD_TO[b], i, SPREAD_FROM[b], j, SPREAD_WEIGHT[b], i, j);
+	}
+	fprintf(fp, "}\n");
+
+	if (fclose(fp) != 0) {
+		fprintf(stderr, "cannot write %s\n", file);
+		return 0;
+	}
+	printf("%s: %d of %d connections\n", file, n_present, n);
+	return 1;
+}
+
+
+/* 1 if the compiled kernel has every connection of the network */
+
+int network_fits_kernel()
+{
+#ifdef NETWORK_KERNEL
+	int b, i, j, n;
+
+	for (b = 0, n = 0; b < N_SPREAD_BLOCKs; b++)
+		for (i = 0; i < SPREAD_N_TO[b]; i++)
+			for (j = 0; j < SPREAD_N_FROM[b]; j++, n++)
+				if (SPREAD_CON[b][j * SPREAD_N_TO[b] + i] != 0.0 && !KERNEL_LINKS[n])
+					return 0;
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+
+
+
+/*****************
+ * SENSITIVITIES *
+ *****************/
+
+/*
+   Forward-mode derivatives. Each parameter p gets a tangent state dact[p] 
+   = d(act)/dp, which is stepped along with the activations:
+     d(act)/dp <- keep * d(act)/dp + d(keep)/dp * act + d(input)/dp,
+   where d(input)/dp spreads d(act)/dp over the weights and act over 
+   d(weights)/dp. Every entry of a weight set is a product of rates and 
+   lesion factors, or 1 - DECAY_rate * factor, so it is affine in each 
+   parameter, and d(weights)/dp is exactly the difference between the 
+   weight sets with p = 1 and p = 0. These tangent weight sets are derived 
+   once per cached weight set and group. The tangents are spread in one 
+   pass over the connections present in the network, like the kernel.
+*/
+
+/* a present connection, as offsets in doubles into LAYERS and WEIGHT_SET */
+typedef struct {
+	int to, from, weight;
+} SPREAD_LINK;
+
+#define LAYER_AT(x) (offsetof(LAYERS, x) / sizeof(double))
+#define MATRIX_AT(x) (offsetof(WEIGHT_SET, x) / sizeof(double))
+
+/* the layers and matrices of SPREAD_TO, SPREAD_FROM and SPREAD_WEIGHT */
+int SPREAD_TO_AT[N_SPREAD_BLOCKs] = { LAYER_AT(C), LAYER_AT(C), LAYER_AT(L), LAYER_AT(L), LAYER_AT(M), 
+                                      LAYER_AT(M), LAYER_AT(oP), LAYER_AT(oP), LAYER_AT(S), LAYER_AT(iP), 
+                                      LAYER_AT(iM) };
+int SPREAD_FROM_AT[N_SPREAD_BLOCKs] = { LAYER_AT(C), LAYER_AT(L), LAYER_AT(C), LAYER_AT(iM), LAYER_AT(L), 
+                                        LAYER_AT(iM), LAYER_AT(M), LAYER_AT(iP), LAYER_AT(oP), LAYER_AT(oP), 
+                                        LAYER_AT(iP) };
+int SPREAD_WEIGHT_AT[N_SPREAD_BLOCKs] = { MATRIX_AT(CC), MATRIX_AT(LC), MATRIX_AT(CL), MATRIX_AT(iML), 
+                                          MATRIX_AT(LM), MATRIX_AT(iMM), MATRIX_AT(MP), MATRIX_AT(iPoP), 
+                                          MATRIX_AT(PS), MATRIX_AT(oPiP), MATRIX_AT(PiM) };
+
+/* the weight matrices lie between CC and keep_C */
+#define N_MAX_SPREAD_LINKs (MATRIX_AT(keep_C) - MATRIX_AT(CC))
+
+SPREAD_LINK SPREAD_LINKS[N_MAX_SPREAD_LINKs];
+int N_SPREAD_LINKs = 0;
+
+
+void derive_spread_links()
+{
+	SPREAD_LINK *l;
+	int b, i, j;
+
+	N_SPREAD_LINKs = 0;
+	for (b = 0; b < N_SPREAD_BLOCKs; b++)
+		for (i = 0; i < SPREAD_N_TO[b]; i++)
+			for (j = 0; j < SPREAD_N_FROM[b]; j++)
+				if (SPREAD_CON[b][j * SPREAD_N_TO[b] + i] != 0.0) {
+					l = &SPREAD_LINKS[N_SPREAD_LINKs++];
+					l->to = SPREAD_TO_AT[b] + i;
+					l->from = SPREAD_FROM_AT[b] + j;
+					l->weight = SPREAD_WEIGHT_AT[b] + i * SPREAD_N_FROM[b] + j;
+				}
+}
+
+
+void derive_weight_set_tangent(int param, WEIGHT_SET *dw)
+{
+	WEIGHT_SET w0;
+	WEIGHT_SET *w;
+	double rate[N_RATEs], weight_factor, decay_factor;
+	double *d1 = (double *) dw, *d0 = (double *) &w0;
+	int i, k;
+
+	for (k = 0; k <= 1; k++) {
+		w = (k == 0 ? &w0 : dw);
+
+		for (i = 0; i < N_RATEs; i++)
+			rate[i] = *RATE_VARIABLE[i];
+		weight_factor = (WEIGHT_LESION ? WEIGHT_value[lesion_value] : 1.0);
+		decay_factor = (DECAY_LESION ? DECAY_value[lesion_value] : 1.0);
+
+		if (param < N_RATEs)
+			rate[param] = k;
+		else if (WEIGHT_LESION)
+			weight_factor = k;
+		else
+			decay_factor = k;
+
+		get_rate_configuration(&w->config, rate);
+		add_lesion(&w->config, group, weight_factor, decay_factor); /* groups are sites */
+		derive_weight_set(w);
+	}
+
+	/* a weight set holds doubles only up to its propagator (its config becomes meaningless here) */
+	for (i = 0; i < (int) (offsetof(WEIGHT_SET, propagator) / sizeof(double)); i++)
+		d1[i] -= d0[i];
+}
+
+
+/* one step of the activations and of n tangent states */
+
+void network_step_tangent(LAYERS *act, LAYERS dact[], int n, const WEIGHT_SET *w, 
+	const WEIGHT_SET dw[], int task, int T)
+{
+	LAYERS input, dinput[N_SENS_PARAMs], prev;
+	const double *a = (const double *) act, *wd = (const double *) w;
+	const SPREAD_LINK *l;
+	int k, p;
+
+	memset(&input, 0, sizeof(input));
+	get_external_input(&input, w, task, T);
+	for (p = 0; p < n; p++) {
+		memset(&dinput[p], 0, sizeof(dinput[p]));
+		get_external_input(&dinput[p], &dw[p], task, T);
+	}
+
+	/* weights * act, and weights * dact + d(weights)/dp * act of all tangents, per connection */
+	for (k = 0, l = SPREAD_LINKS; k < N_SPREAD_LINKs; k++, l++) {
+		((double *) &input)[l->to] += a[l->from] * wd[l->weight];
+		for (p = 0; p < n; p++)
+			((double *) &dinput[p])[l->to] += wd[l->weight] * ((const double *) &dact[p])[l->from] 
+				+ ((const double *) &dw[p])[l->weight] * a[l->from];
+	}
+
+	for (p = 0; p < n; p++) {
+		update_activation_of_nodes(&dact[p], &dinput[p], w); /* keep * dact + dinput */
+		prev = *act;
+		update_activation_of_nodes(&prev, &dact[p], &dw[p]); /* + dkeep * act */
+		dact[p] = prev;
+	}
+
+	update_activation_of_nodes(act, &input, w); /* as network_step() */
+}
+
+
+/* fills D_MEAN_ACT_* of the current lesion value, group and task */
+
+void compute_sensitivities()
+{
+	WEIGHT_SET *dw;
+	LAYERS act, dact[N_SENS_PARAMs];
+	int i = (int) (W - WEIGHT_CACHE), p, s;
+
+	memset(&act, 0, sizeof(act));
+	memset(dact, 0, sizeof(dact));
+
+	/* through the lesion factor, the tangents also depend on the group */
+	if (TANGENT_GROUP[i] != group) {
+		for (p = 0; p < N_SENS_PARAMs; p++)
+			derive_weight_set_tangent(p, &TANGENT_CACHE[i][p]);
+		TANGENT_GROUP[i] = group;
+	}
+	dw = TANGENT_CACHE[i];
+
+	for (p = 0; p < N_SENS_PARAMs; p++) {
+		D_MEAN_ACT_CT[lesion_value][group][task][p] = 0.0;
+		D_MEAN_ACT_CR[lesion_value][group][task][p] = 0.0;
+		D_MEAN_ACT_ST[lesion_value][group][task][p] = 0.0;
+		D_MEAN_ACT_SR[lesion_value][group][task][p] = 0.0;
+	}
+
+	for (s = 0; s < N_STEPs; s++) {
+		network_step_tangent(&act, dact, N_SENS_PARAMs, W, dw, task, s * STEP_SIZE);
+		for (p = 0; p < N_SENS_PARAMs; p++) {
+			D_MEAN_ACT_CT[lesion_value][group][task][p] += dact[p].C[CAT] / N_STEPs;
+			D_MEAN_ACT_CR[lesion_value][group][task][p] += dact[p].C[DOG] / N_STEPs;
+			D_MEAN_ACT_ST[lesion_value][group][task][p] += dact[p].S[CAT] / N_STEPs;
+			D_MEAN_ACT_SR[lesion_value][group][task][p] += dact[p].S[MAT] / N_STEPs;
+		}
+	}
+}
+
+
+
+
+/*********************************
+ * CLOSED-FORM MEAN ACTIVATIONS *
+ *********************************/
+
+/*
+   Between changes of the external input, the network is linear:
+   x(s+1) = A x(s) + e, with A holding the decay and weights of the 
+   current weight set. For a segment 
+   of n steps with constant e, starting from x, the state at its end is
+     x(s+n) = A^n x + (I + A + ... + A^(n-1)) e,
+   and because (I-A) x(s+m) = x(s+m) - x(s+m+1) + e, the sum of the 
+   recorded states is 
+     x(s+1) + ... + x(s+n) = (I-A)^-1 (A x - A x(s+n) + n e).
+   A^n is applied through the squares A, A^2, A^4, ..., and (I-A) is 
+   factored once, so that a segment costs a few matrix-vector products 
+   and triangular solves.
+*/
+
+void build_system_matrix(const WEIGHT_SET *w, double A[N_NODEs][N_NODEs])
+{
+	int i, j;
+
+	for (i = 0; i < N_NODEs; i++)
+		for (j = 0; j < N_NODEs; j++)
+			A[i][j] = 0.0;
+
+	for (i = 0; i < N_CONCEPTs; i++)  A[OFF_C + i][OFF_C + i] = w->keep_C;
+	for (i = 0; i < N_LEMMAs; i++)    A[OFF_L + i][OFF_L + i] = w->keep_L;
+	for (i = 0; i < N_MORPHEMEs; i++) A[OFF_M + i][OFF_M + i] = w->keep_M;
+	for (i = 0; i < N_PHONEMEs; i++)  A[OFF_oP + i][OFF_oP + i] = w->keep_oP;
+	for (i = 0; i < N_PHONEMEs; i++)  A[OFF_iP + i][OFF_iP + i] = w->keep_iP;
+	for (i = 0; i < N_MORPHEMEs; i++) A[OFF_iM + i][OFF_iM + i] = w->keep_iM;
+	for (i = 0; i < N_SYLLABLEs; i++) A[OFF_S + i][OFF_S + i] = w->keep_S;
+
+	/* same weights as in get_internal_input() */
+	for (i = 0; i < N_CONCEPTs; i++)
+		for (j = 0; j < N_CONCEPTs; j++)
+			A[OFF_C + i][OFF_C + j] += w->CC[i][j];
+
+	for (i = 0; i < N_CONCEPTs; i++)
+		for (j = 0; j < N_LEMMAs; j++)
+			A[OFF_C + i][OFF_L + j] += w->LC[i][j];
+
+	for (i = 0; i < N_LEMMAs; i++)
+		for (j = 0; j < N_CONCEPTs; j++)
+			A[OFF_L + i][OFF_C + j] += w->CL[i][j];
+
+	for (i = 0; i < N_LEMMAs; i++)
+		for (j = 0; j < N_MORPHEMEs; j++)
+			A[OFF_L + i][OFF_iM + j] += w->iML[i][j];
+
+	for (i = 0; i < N_MORPHEMEs; i++)
+		for (j = 0; j < N_LEMMAs; j++)
+			A[OFF_M + i][OFF_L + j] += w->LM[i][j];
+
+	for (i = 0; i < N_MORPHEMEs; i++)
+		for (j = 0; j < N_MORPHEMEs; j++)
+			A[OFF_M + i][OFF_iM + j] += w->iMM[i][j];
+
+	for (i = 0; i < N_PHONEMEs; i++)
+		for (j = 0; j < N_MORPHEMEs; j++)
+			A[OFF_oP + i][OFF_M + j] += w->MP[i][j];
+
+	for (i = 0; i < N_PHONEMEs; i++)
+		for (j = 0; j < N_PHONEMEs; j++)
+			A[OFF_oP + i][OFF_iP + j] += w->iPoP[i][j];
+
+	for (i = 0; i < N_SYLLABLEs; i++)
+		for (j = 0; j < N_PHONEMEs; j++)
+			A[OFF_S + i][OFF_oP + j] += w->PS[i][j];
+
+	for (i = 0; i < N_PHONEMEs; i++)
+		for (j = 0; j < N_PHONEMEs; j++)
+			A[OFF_iP + i][OFF_oP + j] += w->oPiP[i][j];
+
+	for (i = 0; i < N_MORPHEMEs; i++)
+		for (j = 0; j < N_PHONEMEs; j++)
+			A[OFF_iM + i][OFF_iP + j] += w->PiM[i][j];
+}
+
+
+/* external input at time T as a state vector */
+
+void get_external_input_vector(double e[N_NODEs])
+{
+	LAYERS input;
+
+	memset(&input, 0, sizeof(input));
+	get_external_input(&input, W, task, T);
+	layers_to_vector(&input, e);
+}
+
+
+/* LU factorization with partial pivoting, in place; 0 if singular */
+
+int lu_factor(double G[N_NODEs][N_NODEs], int pivot[N_NODEs])
+{
+	int i, j, k, p;
+	double m, t;
+
+	for (k = 0; k < N_NODEs; k++) {
+		for (p = k, i = k + 1; i < N_NODEs; i++)
+			if (fabs(G[i][k]) > fabs(G[p][k]))
+				p = i;
+		if (fabs(G[p][k]) < 1e-12)
+			return 0;
+		pivot[k] = p;
+		if (p != k)
+			for (j = 0; j < N_NODEs; j++) {
+				t = G[k][j]; G[k][j] = G[p][j]; G[p][j] = t;
+			}
+		for (i = k + 1; i < N_NODEs; i++) {
+			m = (G[i][k] /= G[k][k]);
+			for (j = k + 1; j < N_NODEs; j++)
+				G[i][j] -= m * G[k][j];
+		}
+	}
+	return 1;
+}
+
+
+/* solves G y = b, with G factored by lu_factor(); y replaces b */
+
+void lu_solve(double G[N_NODEs][N_NODEs], int pivot[N_NODEs], double b[N_NODEs])
+{
+	int i, j;
+	double t;
+
+	for (i = 0; i < N_NODEs; i++)
+		if (pivot[i] != i) {
+			t = b[i]; b[i] = b[pivot[i]]; b[pivot[i]] = t;
+		}
+
+	for (i = 0; i < N_NODEs; i++)
+		for (j = 0; j < i; j++)
+			b[i] -= G[i][j] * b[j];
+
+	for (i = N_NODEs - 1; i >= 0; i--) {
+		for (j = i + 1; j < N_NODEs; j++)
+			b[i] -= G[i][j] * b[j];
+		b[i] /= G[i][i];
+	}
+}
+
+
+void mat_mul(double C[N_NODEs][N_NODEs], double A[N_NODEs][N_NODEs], double B[N_NODEs][N_NODEs])
+{
+	int i, j, k;
+	double a;
+
+	for (i = 0; i < N_NODEs; i++)
+		for (j = 0; j < N_NODEs; j++)
+			C[i][j] = 0.0;
+
+	for (i = 0; i < N_NODEs; i++)
+		for (k = 0; k < N_NODEs; k++) {
+			a = A[i][k];
+			if (a != 0.0)
+				for (j = 0; j < N_NODEs; j++)
+					C[i][j] += a * B[k][j];
+		}
+}
+
+
+/* v = A^n v, with P[k] = A^(2^k) from set_up_closed_form() */
+
+void apply_matrix_power(double P[N_POWERs][N_NODEs][N_NODEs], int n, double v[N_NODEs])
+{
+	double w[N_NODEs];
+	int i, j, k;
+
+	for (k = 0; n > 0; k++, n >>= 1)
+		if (n & 1) {
+			for (i = 0; i < N_NODEs; i++) {
+				w[i] = 0.0;
+				for (j = 0; j < N_NODEs; j++)
+					w[i] += P[k][i][j] * v[j];
+			}
+			for (i = 0; i < N_NODEs; i++)
+				v[i] = w[i];
+		}
+}
+
+
+/*
+   Builds A, factors (I-A) and squares A up to the trial length. All of 
+   this only depends on the group and lesion value, so it is redone only
+   when A changes (e.g., not across tasks or for the NORMAL group). 
+   Returns 0 if (I-A) is singular.
+*/
+
+int set_up_closed_form()
+{
+	static double A[N_NODEs][N_NODEs];
+	int i, j, k;
+
+	if (EXPONENTIAL_INTEGRATION)
+		memcpy(A, W->propagator->PHI, sizeof(A));
+	else
+		build_system_matrix(W, A);
+
+	if (CF_valid && memcmp(A, CF_A, sizeof(A)) == 0)
+		return CF_ok;
+
+	memcpy(CF_A, A, sizeof(A));
+	CF_valid = 1;
+
+	for (i = 0; i < N_NODEs; i++)
+		for (j = 0; j < N_NODEs; j++)
+			CF_G[i][j] = (i == j ? 1.0 : 0.0) - A[i][j];
+
+	CF_ok = lu_factor(CF_G, CF_pivot);
+
+	memcpy(CF_P[0], A, sizeof(A));
+	for (k = 1; k < N_POWERs && (1 << k) <= N_STEPs; k++)
+		mat_mul(CF_P[k], CF_P[k-1], CF_P[k-1]);
+
+	return CF_ok;
+}
+
+
+/* 
+   Fills MEAN_ACT_* (and MEAN_ACT_TYPE) of the current lesion value, group 
+   and task without stepping the network. Returns 0 if (I-A) is singular, 
+   in which case the trial has to be run step by step.
+*/
+
+int compute_mean_activation_closed_form()
+{
+	double x[N_NODEs], e[N_NODEs], next_e[N_NODEs], u[N_NODEs], x_end[N_NODEs], y[N_NODEs], sum[N_NODEs];
+	int i, j, n, first, level, type, zero_input;
+	int offset[N_LEVELs] = { OFF_C, OFF_L, OFF_S };
+	int n_level[N_LEVELs] = { N_CONCEPTs, N_LEMMAs, N_SYLLABLEs };
+
+	if (!set_up_closed_form())
+		return 0;
+
+	for (i = 0; i < N_NODEs; i++) {
+		x[i] = 0.0;
+		sum[i] = 0.0;
+	}
+
+	first = 0;
+	T = 0;
+	get_external_input_vector(e);
+
+	while (first < N_STEPs) {
+
+		/* length of the segment of constant external input */
+		for (n = 1; first + n < N_STEPs; n++) {
+			T = (first + n) * STEP_SIZE;
+			get_external_input_vector(next_e);
+			for (i = 0; i < N_NODEs; i++)
+				if (next_e[i] != e[i])
+					break;
+			if (i < N_NODEs)
+				break;
+		}
+
+		/* the input as it enters a step, u = GAMMA e when exponential, once per segment */
+		for (i = 0; i < N_NODEs; i++)
+			u[i] = e[i];
+		if (EXPONENTIAL_INTEGRATION)
+			for (i = 0; i < N_NODEs; i++)
+				for (u[i] = 0.0, j = 0; j < N_NODEs; j++)
+					u[i] += W->propagator->GAMMA[i][j] * e[j];
+
+		/* x(s+n) = x* + A^n (x - x*), with fixed point x* = (I-A)^-1 u */
+		for (zero_input = 1, i = 0; i < N_NODEs; i++) {
+			y[i] = u[i];
+			if (u[i] != 0.0)
+				zero_input = 0;
+		}
+		if (!zero_input)
+			lu_solve(CF_G, CF_pivot, y);
+
+		for (i = 0; i < N_NODEs; i++)
+			x_end[i] = x[i] - y[i];
+		apply_matrix_power(CF_P, n, x_end);
+		for (i = 0; i < N_NODEs; i++)
+			x_end[i] += y[i];
+
+		/* sum of the recorded states: (I-A)^-1 (A x - A x(s+n) + n u) */
+		for (i = 0; i < N_NODEs; i++) {
+			y[i] = n * u[i];
+			for (j = 0; j < N_NODEs; j++)
+				y[i] += CF_A[i][j] * (x[j] - x_end[j]);
+		}
+
+		lu_solve(CF_G, CF_pivot, y);
+
+		for (i = 0; i < N_NODEs; i++) {
+			sum[i] += y[i];
+			x[i] = x_end[i];
+		}
+
+		first += n;
+		if (first < N_STEPs) {
+			T = first * STEP_SIZE;
+			get_external_input_vector(e);
+		}
+	}
+
+	MEAN_ACT_C[lesion_value][group][task] = sum[OFF_C + CAT] / N_STEPs;
+	MEAN_ACT_S[lesion_value][group][task] = sum[OFF_S + CAT] / N_STEPs;
+	MEAN_ACT_CT[lesion_value][group][task] = sum[OFF_C + CAT] / N_STEPs;
+	MEAN_ACT_CR[lesion_value][group][task] = sum[OFF_C + DOG] / N_STEPs;
+	MEAN_ACT_LT[lesion_value][group][task] = sum[OFF_L + CAT] / N_STEPs;
+	MEAN_ACT_LR[lesion_value][group][task] = sum[OFF_L + DOG] / N_STEPs;
+	MEAN_ACT_ST[lesion_value][group][task] = sum[OFF_S + CAT] / N_STEPs;
+	MEAN_ACT_SR[lesion_value][group][task] = sum[OFF_S + MAT] / N_STEPs;
+
+	for (level = 0; level < N_LEVELs; level++)
+		for (type = 0; type < N_ERROR_TYPEs; type++) {
+			MEAN_ACT_TYPE[lesion_value][group][task][level][type] = 0.0;
+			for (i = 0; i < n_level[level]; i++)
+				MEAN_ACT_TYPE[lesion_value][group][task][level][type] 
+				  += COMPETITOR_MASK[level][type][i] * sum[offset[level] + i] / N_STEPs;
+		}
+
+	return 1;
+}
+
+
+
+
+/***************************
+ * EXPONENTIAL INTEGRATION *
+ ***************************/
+
+/*
+   A step of forward Euler, x <- A x + e, with A = keep + weights, takes 
+   the change over STEP_SIZE ms to be that at its start. With DECAY_rate 
+   = 0.6 per step, and near 1 for the largest decay lesions, this differs 
+   from finer steps. Between changes of the external input the network is 
+   linear, dx/dt = M x + e per step with M = A - I, so the exact step is 
+     x <- exp(M) x + phi(M) e,   phi(M) = (exp(M) - I) / M = sum M^k / (k+1)!,
+   which is exact for the decay and the spreading together, and equally 
+   cheap per step. PHI = exp(M) and GAMMA = phi(M) are derived with each 
+   weight set, and kept apart from it so that the weight sets stay small: 
+   a cached weight set has its slot in PROPAGATOR_CACHE, and any other one 
+   (the fits derive them one after the other) shares the propagator of 
+   its thread until the thread derives the next. The series for M / 2^s (with its norm below 0.5), then s 
+   squarings, phi(2M) = (exp(M) + I) phi(M) / 2. The rates stay per ms 
+   times STEP_SIZE, so 25 ms steps give the solution that 1 ms steps of 
+   forward Euler approach. The closed form (MEAN_ONLY) steps with PHI and 
+   GAMMA too; the sensitivities and the batched simulations (populations, 
+   grid, precisions) are forward Euler only.
+*/
+
+#define N_SERIES_TERMs 12
+
+void layers_to_vector(const LAYERS *x, double v[N_NODEs])
+{
+	int i;
+
+	for (i = 0; i < N_CONCEPTs; i++)  v[OFF_C + i] = x->C[i];
+	for (i = 0; i < N_LEMMAs; i++)    v[OFF_L + i] = x->L[i];
+	for (i = 0; i < N_MORPHEMEs; i++) v[OFF_M + i] = x->M[i];
+	for (i = 0; i < N_PHONEMEs; i++)  v[OFF_oP + i] = x->oP[i];
+	for (i = 0; i < N_PHONEMEs; i++)  v[OFF_iP + i] = x->iP[i];
+	for (i = 0; i < N_MORPHEMEs; i++) v[OFF_iM + i] = x->iM[i];
+	for (i = 0; i < N_SYLLABLEs; i++) v[OFF_S + i] = x->S[i];
+}
+
+
+void vector_to_layers(const double v[N_NODEs], LAYERS *x)
+{
+	int i;
+
+	for (i = 0; i < N_CONCEPTs; i++)  x->C[i] = v[OFF_C + i];
+	for (i = 0; i < N_LEMMAs; i++)    x->L[i] = v[OFF_L + i];
+	for (i = 0; i < N_MORPHEMEs; i++) x->M[i] = v[OFF_M + i];
+	for (i = 0; i < N_PHONEMEs; i++)  x->oP[i] = v[OFF_oP + i];
+	for (i = 0; i < N_PHONEMEs; i++)  x->iP[i] = v[OFF_iP + i];
+	for (i = 0; i < N_MORPHEMEs; i++) x->iM[i] = v[OFF_iM + i];
+	for (i = 0; i < N_SYLLABLEs; i++) x->S[i] = v[OFF_S + i];
+}
+
+
+/* PHI and GAMMA of the weight set, from its other fields, in the propagator of the thread */
+
+const PROPAGATOR *derive_propagator(const WEIGHT_SET *w)
+{
+	static double M[N_NODEs][N_NODEs], P[N_NODEs][N_NODEs];
+	static PROPAGATOR *scratch = NULL;
+	#pragma omp threadprivate(M, P, scratch)
+	PROPAGATOR *pr;
+	double norm, row, scale;
+	int i, j, k, s;
+
+	if (scratch == NULL && (scratch = malloc(sizeof(PROPAGATOR))) == NULL) {
+		fprintf(stderr, "Cannot allocate a propagator\n");
+		exit(1);
+	}
+	pr = scratch;
+
+	build_system_matrix(w, M);
+	for (i = 0; i < N_NODEs; i++)
+		M[i][i] -= 1.0;
+
+	for (norm = 0.0, i = 0; i < N_NODEs; i++) {
+		for (row = 0.0, j = 0; j < N_NODEs; j++)
+			row += fabs(M[i][j]);
+		if (row > norm)
+			norm = row;
+	}
+	for (s = 0, scale = 1.0; norm * scale > 0.5; s++)
+		scale *= 0.5;
+	for (i = 0; i < N_NODEs; i++)
+		for (j = 0; j < N_NODEs; j++)
+			M[i][j] *= scale;
+
+	/* GAMMA = phi(M) = I + M/2 (I + M/3 (I + ...)), by Horner */
+	for (i = 0; i < N_NODEs; i++)
+		for (j = 0; j < N_NODEs; j++)
+			pr->GAMMA[i][j] = (i == j ? 1.0 : 0.0);
+	for (k = N_SERIES_TERMs; k >= 1; k--) {
+		mat_mul(P, M, pr->GAMMA);
+		for (i = 0; i < N_NODEs; i++)
+			for (j = 0; j < N_NODEs; j++)
+				pr->GAMMA[i][j] = (i == j ? 1.0 : 0.0) + P[i][j] / (k + 1);
+	}
+
+	/* PHI = exp(M) = I + M phi(M) */
+	mat_mul(pr->PHI, M, pr->GAMMA);
+	for (i = 0; i < N_NODEs; i++)
+		pr->PHI[i][i] += 1.0;
+
+	for (; s > 0; s--) {
+		for (i = 0; i < N_NODEs; i++)
+			pr->PHI[i][i] += 1.0;
+		mat_mul(P, pr->PHI, pr->GAMMA);
+		for (i = 0; i < N_NODEs; i++)
+			for (j = 0; j < N_NODEs; j++)
+				pr->GAMMA[i][j] = 0.5 * P[i][j];
+		for (i = 0; i < N_NODEs; i++)
+			pr->PHI[i][i] -= 1.0;
+		mat_mul(P, pr->PHI, pr->PHI);
+		memcpy(pr->PHI, P, sizeof(P));
+	}
+	return pr;
+}
+
+
+/* one exact step: act <- PHI act + GAMMA input, for the external input only */
+
+void propagate(LAYERS *act, const LAYERS *input, const WEIGHT_SET *w)
+{
+	const PROPAGATOR *pr = w->propagator;
+	double x[N_NODEs], e[N_NODEs], y[N_NODEs];
+	int i, j;
+
+	layers_to_vector(act, x);
+	layers_to_vector(input, e);
+
+	/* by columns, so that the sums of the rows do not wait on each other */
+	for (i = 0; i < N_NODEs; i++)
+		y[i] = 0.0;
+	for (j = 0; j < N_NODEs; j++)
+		if (x[j] != 0.0)
+			for (i = 0; i < N_NODEs; i++)
+				y[i] += pr->PHI[i][j] * x[j];
+	for (j = 0; j < N_NODEs; j++)
+		if (e[j] != 0.0)
+			for (i = 0; i < N_NODEs; i++)
+				y[i] += pr->GAMMA[i][j] * e[j];
+
+	vector_to_layers(y, act);
+}
+
+
+
+
+/******************************
+ * GLOBAL FIT OF THE RATES    *
+ ******************************/
+
+/*
+   Fits the rates shared by all simulations (SEM_rate, LEM_rate, LEX_rate, 
+   DECAY_rate, EXTIN, LEMLEXFRAC and FR) jointly to all studies. For a set 
+   of rates, every lesion site is swept over all lesion values, each case 
+   gets its best-fitting lesion value, and the error is the MAE of those 
+   best fits, averaged per study and then over studies. The search is a 
+   compass search in the logarithm of the rates: each rate is raised and 
+   lowered by a relative step, the 2 * N_RATEs candidates are evaluated in 
+   parallel (with OpenMP, if compiled with -fopenmp), and the step is 
+   halved when none improves. A rate set is thus an integer exponent per 
+   rate, in units of the smallest step, and sweeps of exponents that were 
+   evaluated before are taken from a cache. The cases and their lesion 
+   sites are those of STUDY_FILE. The Dutch group means are those of the 
+   Janssen et al. cases, so only the cases are fitted. The fitted rates 
+   are then used for the assessments.
+*/
+
+#define N_SWEEP_CACHE 256
+
+ int SWEEP_CACHE_EXPONENT[N_SWEEP_CACHE][N_RATEs];
+ double SWEEP_CACHE_ERROR[N_SWEEP_CACHE][N_STUDIES + 1];
+ int N_CACHED_SWEEPs = 0;  /* number of sweeps stored so far */
+ int N_REUSED_SWEEPs = 0;
+
+ int FIT_SITE_USED[N_MAX_DEFINED_SITEs]; /* defined sites with fit cases */
+
+
+void set_up_fit_cases()
+{
+	/* the studies of STUDY_FILE in each study of the fit; the Dutch groups are left out */
+	struct { char *title; int study; } fit[] = {
+		{ "Savage et al. (2013), English groups", 0 },
+		{ "Brambati et al. (2015), baseline", 2 },
+		{ "Brambati et al. (2015), follow up", 3 },
+		{ "Rohrer et al. (2013), Mandelli et al. (2016), baseline", 4 },
+		{ "Rohrer et al. (2013), Mandelli et al. (2016), follow up", 5 },
+		{ "Leyton et al. (2015), logopenic clusters", 6 },
+		{ "Savage et al. (2014), semantic cases", 7 },
+		{ "Gorno-Tempini et al. (2008), logopenic cases", 8 },
+		{ "Janssen et al. (2022), nonfluent/agrammatic cases", 9 },
+		{ "Janssen et al. (2022), semantic cases", 9 },
+		{ "Janssen et al. (2022), logopenic cases", 9 }
+	};
+	int i, k;
+
+	N_FIT_CASEs = 0;
+	memset(FIT_SITE_USED, 0, sizeof(FIT_SITE_USED));
+
+	for (i = 0; i < N_DEFINED_CASEs && N_FIT_CASEs < N_MAX_FIT_CASEs; i++)
+		for (k = 0; k < (int) (sizeof(fit) / sizeof(fit[0])); k++)
+			if (strcmp(DEFINED_STUDY_TITLE[DEFINED_CASE_STUDY[i]], fit[k].title) == 0) {
+				FIT_CASE_STUDY[N_FIT_CASEs] = fit[k].study;
+				FIT_CASE_SITE[N_FIT_CASEs] = DEFINED_CASE_SITE[i];
+				FIT_CASE_DATA[N_FIT_CASEs] = DEFINED_CASE_DATA[i];
+				FIT_SITE_USED[DEFINED_CASE_SITE[i]] = 1;
+				N_FIT_CASEs++;
+			}
+}
+
+
+/* summed activation of the nodes that determine the score of a task */
+
+void run_fit_trial(const WEIGHT_SET *w, int task, double *target, double *relative)
+{
+	LAYERS act;
+	int s;
+
+	memset(&act, 0, sizeof(act));
+	*target = 0.0;
+	*relative = 0.0;
+
+	for (s = 0; s < N_STEPs; s++) {
+		network_step(&act, w, task, s * STEP_SIZE);
+		if (task == COMPREHENSION) {
+			*target += act.C[CAT];
+			*relative += act.C[DOG];
+		}
+		else {
+			*target += act.S[CAT];
+			*relative += act.S[MAT];
+		}
+	}
+}
+
+
+/* 
+   Best-fit MAE per study, and over studies in study_error[N_STUDIES], for 
+   one set of rates. Reentrant: safe to run for several rate sets at once.
+*/
+
+void sweep_fit_errors(const double rate[N_RATEs], double study_error[N_STUDIES + 1])
+{
+	double score[N_MAX_DEFINED_SITEs][N_lesion_values][N_TASKs];
+	WEIGHT_CONFIGURATION c;
+	WEIGHT_SET w;
+	double normal[N_TASKs], target, relative, error, best;
+	int n_cases[N_STUDIES];
+	int site, lv, t, i, n;
+
+	get_rate_configuration(&w.config, rate);
+	derive_weight_set(&w);
+	for (t = 0; t < N_TASKs; t++) {
+		run_fit_trial(&w, t, &target, &relative);
+		normal[t] = target - relative;
+	}
+
+	for (site = 0; site < N_DEFINED_SITEs; site++)
+		for (lv = 0; lv < N_lesion_values && FIT_SITE_USED[site]; lv++) {
+			get_rate_configuration(&c, rate);
+			add_lesion_at(&c, DEFINED_SITE_BLOCKS[site], DEFINED_SITE_LAYERS[site], 
+			              WEIGHT_LESION ? WEIGHT_value[lv] : 1.0, DECAY_LESION ? DECAY_value[lv] : 1.0);
+			w.config = c;
+			derive_weight_set(&w);
+			for (t = 0; t < N_TASKs; t++) {
+				run_fit_trial(&w, t, &target, &relative);
+				score[site][lv][t] = (target - relative) / normal[t] * 100.0;
+			}
+		}
+
+	for (i = 0; i <= N_STUDIES; i++)
+		study_error[i] = 0.0;
+	for (i = 0; i < N_STUDIES; i++)
+		n_cases[i] = 0;
+
+	for (i = 0; i < N_FIT_CASEs; i++) {
+		site = FIT_CASE_SITE[i];
+		for (best = DBL_MAX, lv = 0; lv < N_lesion_values; lv++) {
+			for (error = 0.0, t = 0; t < N_TASKs; t++)
+				error += fabs(FIT_CASE_DATA[i][t] - score[site][lv][t]);
+			if (error / 3.0 < best)
+				best = error / 3.0;
+		}
+		study_error[FIT_CASE_STUDY[i]] += best;
+		n_cases[FIT_CASE_STUDY[i]]++;
+	}
+
+	for (n = 0, i = 0; i < N_STUDIES; i++)
+		if (n_cases[i] > 0) {
+			study_error[i] /= n_cases[i];
+			study_error[N_STUDIES] += study_error[i];
+			n++;
+		}
+	study_error[N_STUDIES] /= n;
+}
+
+
+int valid_rates(const double rate[N_RATEs])
+{
+	double max_decay = (DECAY_LESION ? DECAY_value[N_lesion_values - 1] : 1.0);
+	int i;
+
+	for (i = 0; i < N_RATEs; i++)
+		if (rate[i] <= 0.0)
+			return 0;
+
+	return rate[R_LEMLEXFRAC] <= 1.0 && rate[R_FR] <= 1.0 
+	       && rate[R_DECAY] * max_decay < 1.0;
+}
+
+
+void print_rates(const double rate[N_RATEs])
+{
+	printf("sem_rate   : %.4f [prop/ms]\n", rate[R_SEM] / STEP_SIZE);
+	printf("lem_rate   : %.4f [prop/ms]\n", rate[R_LEM] / STEP_SIZE);
+	printf("lex_rate   : %.4f [prop/ms]\n", rate[R_LEX] / STEP_SIZE);
+	printf("d          : %.4f [prop/ms]\n", rate[R_DECAY] / STEP_SIZE);
+	printf("exin       : %.4f [act_units/ms]\n", rate[R_EXTIN] / STEP_SIZE);
+	printf("lemlexfrac : %.4f\n", rate[R_LEMLEXFRAC]);
+	printf("fr         : %.4f\n", rate[R_FR]);
+}
+
+
+void fit_rates()
+{
+	double start_rate[N_RATEs], rate[N_RATEs], start_error[N_STUDIES + 1], best_error[N_STUDIES + 1];
+	double candidate[2 * N_RATEs][N_RATEs], candidate_error[2 * N_RATEs][N_STUDIES + 1];
+	double factor;
+	int exponent[N_RATEs], candidate_exponent[2 * N_RATEs][N_RATEs];
+	int slot[2 * N_RATEs];
+	int fitted[N_STUDIES] = { 0 };
+	int iteration, i, j, k, best, n_units, step_units, n_studies;
+
+	set_up_fit_cases();
+
+	/* exponents count steps of the smallest size; the first step is n_units of them */
+	for (n_units = 1, factor = FIT_INITIAL_STEP; factor / 2.0 >= FIT_MIN_STEP; factor /= 2.0)
+		n_units *= 2;
+	step_units = n_units;
+
+	for (i = 0; i < N_RATEs; i++) {
+		start_rate[i] = rate[i] = *RATE_VARIABLE[i];
+		exponent[i] = 0;
+	}
+
+	for (i = 0; i < N_FIT_CASEs; i++)
+		fitted[FIT_CASE_STUDY[i]] = 1;
+	for (n_studies = 0, i = 0; i < N_STUDIES; i++)
+		n_studies += fitted[i];
+
+	printf("\nGLOBAL FIT OF THE RATES\n");
+	printf("%d cases in %d studies, %d candidate rate sets per iteration", 
+	       N_FIT_CASEs, n_studies, 2 * N_RATEs);
+#ifdef _OPENMP
+	printf(" on %d threads", omp_get_max_threads());
+#endif
+	printf("\n");
+
+	sweep_fit_errors(rate, start_error);
+	memcpy(best_error, start_error, sizeof(start_error));
+	printf("\nStart rates:\n");
+	print_rates(rate);
+	printf("\nStart:        MAE = %.3f\n", best_error[N_STUDIES]);
+
+	memcpy(SWEEP_CACHE_EXPONENT[0], exponent, sizeof(exponent));
+	memcpy(SWEEP_CACHE_ERROR[0], start_error, sizeof(start_error));
+	N_CACHED_SWEEPs = 1;
+
+	for (iteration = 1; iteration <= FIT_MAX_ITERATIONs && step_units >= 1; iteration++) {
+
+		/* candidates, and whether their sweeps are cached; slot -1 if invalid */
+		for (k = 0; k < 2 * N_RATEs; k++) {
+			memcpy(candidate_exponent[k], exponent, sizeof(exponent));
+			candidate_exponent[k][k / 2] += (k % 2 == 0 ? step_units : -step_units);
+			memcpy(candidate[k], rate, sizeof(rate));
+			candidate[k][k / 2] = start_rate[k / 2] 
+				* pow(1.0 + FIT_INITIAL_STEP, (double) candidate_exponent[k][k / 2] / n_units);
+
+			slot[k] = -1;
+			if (!valid_rates(candidate[k]))
+				continue;
+			for (j = 0; j < N_CACHED_SWEEPs && j < N_SWEEP_CACHE; j++)
+				if (memcmp(SWEEP_CACHE_EXPONENT[j], candidate_exponent[k], sizeof(exponent)) == 0)
+					break;
+			if (j < N_CACHED_SWEEPs && j < N_SWEEP_CACHE) {
+				memcpy(candidate_error[k], SWEEP_CACHE_ERROR[j], sizeof(start_error));
+				slot[k] = N_SWEEP_CACHE; /* cached */
+				N_REUSED_SWEEPs++;
+			}
+			else
+				slot[k] = N_CACHED_SWEEPs++ % N_SWEEP_CACHE;
+		}
+
+		#pragma omp parallel for schedule(dynamic)
+		for (k = 0; k < 2 * N_RATEs; k++)
+			if (slot[k] >= 0 && slot[k] < N_SWEEP_CACHE)
+				sweep_fit_errors(candidate[k], candidate_error[k]);
+
+		for (best = -1, k = 0; k < 2 * N_RATEs; k++) {
+			if (slot[k] < 0)
+				continue;
+			if (slot[k] < N_SWEEP_CACHE) {
+				memcpy(SWEEP_CACHE_EXPONENT[slot[k]], candidate_exponent[k], sizeof(exponent));
+				memcpy(SWEEP_CACHE_ERROR[slot[k]], candidate_error[k], sizeof(start_error));
+			}
+			if (candidate_error[k][N_STUDIES] < best_error[N_STUDIES] 
+			    && (best < 0 || candidate_error[k][N_STUDIES] < candidate_error[best][N_STUDIES]))
+				best = k;
+		}
+
+		if (best >= 0) {
+			memcpy(rate, candidate[best], sizeof(rate));
+			memcpy(exponent, candidate_exponent[best], sizeof(exponent));
+			memcpy(best_error, candidate_error[best], sizeof(start_error));
+		}
+		else
+			step_units /= 2;
+
+		/* the relative change of a rate in the next iteration, 0 when done */
+		printf("Iteration %2d: MAE = %.3f   step = %.4f\n", iteration, best_error[N_STUDIES], 
+		       pow(1.0 + FIT_INITIAL_STEP, (double) step_units / n_units) - 1.0);
+	}
+
+	printf("\nFitted rates:\n");
+	print_rates(rate);
+
+	printf("\nBest-fit MAE per study:   start   fitted\n");
+	for (i = 0; i <= N_STUDIES; i++) {
+		if (i < N_STUDIES && !fitted[i])
+			printf("%-24s      -        -   (not fitted)\n", STUDY_NAME[i]);
+		else
+			printf("%-24s %6.2f   %6.2f\n", 
+			       i < N_STUDIES ? STUDY_NAME[i] : "All studies", start_error[i], best_error[i]);
+	}
+	printf("%d sweeps run, %d taken from the cache\n", N_CACHED_SWEEPs, N_REUSED_SWEEPs);
+
+	/* the assessments below use the fitted rates */
+	for (i = 0; i < N_RATEs; i++)
+		*RATE_VARIABLE[i] = rate[i];
+}
+
+
+
+
+/***********************
+ * BOOTSTRAP INTERVALS *
+ ***********************/
+
+/*
+   Percentile intervals of the best-fit lesion values. The simulated scores 
+   of all lesion values are put in a table once per assessment, and every 
+   bootstrap sample is refitted against that table. A sample resamples the 
+   patients of a group where their data are available (the Dutch groups are 
+   the Janssen et al. cases), and otherwise the items: each task score is 
+   redrawn as the proportion correct of N_ITEMs items answered correctly 
+   with the observed probability. Samples run in parallel (with OpenMP); 
+   each has its own random stream, so the intervals do not depend on the 
+   number of threads.
+*/
+
+double (*SCORE_TABLE)[N_GROUPs][N_TASKs];
+
+
+void compute_score_table()
+{
+	int lv, g;
+
+	for (lv = 0; lv < N_lesion_values; lv++)
+		for (g = 0; g < N_GROUPs; g++) {
+			SCORE_TABLE[lv][g][NAMING] = (MEAN_ACT_ST[lv][g][NAMING] - MEAN_ACT_SR[lv][g][NAMING])
+				/ (MEAN_ACT_ST[lv][NORMAL][NAMING] - MEAN_ACT_SR[lv][NORMAL][NAMING]) * 100.0;
+			SCORE_TABLE[lv][g][COMPREHENSION] = (MEAN_ACT_CT[lv][g][COMPREHENSION] 
+				- MEAN_ACT_CR[lv][g][COMPREHENSION])
+				/ (MEAN_ACT_CT[lv][NORMAL][COMPREHENSION] - MEAN_ACT_CR[lv][NORMAL][COMPREHENSION]) * 100.0;
+			SCORE_TABLE[lv][g][REPETITION] = (MEAN_ACT_ST[lv][g][REPETITION] - MEAN_ACT_SR[lv][g][REPETITION])
+				/ (MEAN_ACT_ST[lv][NORMAL][REPETITION] - MEAN_ACT_SR[lv][NORMAL][REPETITION]) * 100.0;
+		}
+}
+
+
+/* splitmix64 */
+
+unsigned long long next_random(unsigned long long *state)
+{
+	unsigned long long z = (*state += 0x9E3779B97F4A7C15ULL);
+
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+
+/* lesion value index with the lowest MAE for the current group, as in the fits */
+
+int best_fit_in_score_table(double data[N_TASKs])
+{
+	double error, best = DBL_MAX;
+	int lv, a = 0;
+
+	for (lv = 0; lv < N_lesion_values; lv++) {
+		error = (fabs(data[NAMING] - SCORE_TABLE[lv][group][NAMING])
+		       + fabs(data[COMPREHENSION] - SCORE_TABLE[lv][group][COMPREHENSION])
+		       + fabs(data[REPETITION] - SCORE_TABLE[lv][group][REPETITION])) / 3.0;
+		if (error < best) {
+			best = error;
+			a = lv;
+		}
+	}
+	return a;
+}
+
+
+void bootstrap_sample(unsigned long long *state, double data[N_TASKs])
+{
+	double (*cases)[N_TASKs] = NULL;
+	double p;
+	int n_cases = 0, i, k, t, correct;
+
+	if (assessment == DUTCH && group != NORMAL)
+		n_cases = janssen_cases(group, &cases);
+
+	if (cases != NULL) {
+		/* patients */
+		for (t = 0; t < N_TASKs; t++)
+			data[t] = 0.0;
+		for (i = 0; i < n_cases; i++) {
+			k = (int) (next_random(state) % n_cases);
+			for (t = 0; t < N_TASKs; t++)
+				data[t] += cases[k][t] / n_cases;
+		}
+	}
+	else
+		/* items */
+		for (t = 0; t < N_TASKs; t++) {
+			p = REAL_DATA[group][t] / 100.0;
+			for (correct = 0, i = 0; i < N_ITEMs; i++)
+				if ((next_random(state) >> 11) * (1.0 / 9007199254740992.0) < p)
+					correct++;
+			data[t] = 100.0 * correct / N_ITEMs;
+		}
+}
+
+
+void print_bootstrap_interval()
+{
+	int count[N_lesion_values]; /* shared by the threads */
+	double *value = (WEIGHT_LESION ? WEIGHT_value : DECAY_value);
+	int lv, b, lo, hi, sum;
+
+	for (lv = 0; lv < N_lesion_values; lv++)
+		count[lv] = 0;
+
+	#pragma omp parallel for schedule(static)
+	for (b = 0; b < N_BOOTSTRAP_SAMPLEs; b++) {
+		unsigned long long state = 12345ULL + 1000003ULL * (assessment * N_GROUPs + group) + b;
+		double data[N_TASKs];
+		int a;
+
+		bootstrap_sample(&state, data);
+		a = best_fit_in_score_table(data);
+		#pragma omp atomic
+		count[a]++;
+	}
+
+	/* percentiles from the histogram of best-fit indices */
+	for (sum = 0, lo = 0; lo < N_lesion_values - 1; lo++)
+		if ((sum += count[lo]) > (1.0 - BOOTSTRAP_LEVEL) / 2.0 * N_BOOTSTRAP_SAMPLEs)
+			break;
+	for (sum = 0, hi = N_lesion_values - 1; hi > 0; hi--)
+		if ((sum += count[hi]) > (1.0 - BOOTSTRAP_LEVEL) / 2.0 * N_BOOTSTRAP_SAMPLEs)
+			break;
+
+	printf("Bootstrap %.0f%% interval: %s value %.2f - %.2f (%d %s samples)\n",
+		BOOTSTRAP_LEVEL * 100.0, WEIGHT_LESION ? "weight" : "decay", value[lo], value[hi], 
+		N_BOOTSTRAP_SAMPLEs, assessment == DUTCH ? "patient" : "item");
+}
+
+
+
+
+/***********************
+ * DISEASE PROGRESSION *
+ ***********************/
+
+/*
+   Joint fit of baseline and follow-up. The lesion value of a group may 
+   only progress between the visits (weights weaken, decay grows), and the 
+   pair of values with the lowest MAE over both visits is taken. The 
+   baseline is swept as usual; the follow-up search is warm-started from 
+   the baseline value and descends to the nearest minimum, and the pair is 
+   then refined jointly under the progression constraint. All errors are 
+   read from SCORE_TABLE, which holds the simulations of the baseline (they 
+   do not depend on the data, so the follow-up is not simulated again). 
+   Assuming the lesion progresses linearly in time, scores at later visits 
+   are projected by interpolating the table.
+*/
+
+/* MAE of lesion value index lv for the current group */
+
+double table_error(int lv, const double data[N_TASKs])
+{
+	return (fabs(data[NAMING] - SCORE_TABLE[lv][group][NAMING])
+	      + fabs(data[COMPREHENSION] - SCORE_TABLE[lv][group][COMPREHENSION])
+	      + fabs(data[REPETITION] - SCORE_TABLE[lv][group][REPETITION])) / 3.0;
+}
+
+
+/* whether lesion value index lv2 is the same lesion as lv1 or a worse one */
+
+int progressed(int lv1, int lv2)
+{
+	return (WEIGHT_LESION ? lv2 <= lv1 : lv2 >= lv1);
+}
+
+
+/* nearest minimum of the error, starting from lesion value index lv */
+
+int descend_from(int lv, const double data[N_TASKs], int *n_evaluated)
+{
+	double e = table_error(lv, data), e_down, e_up;
+
+	*n_evaluated += 1;
+	for (;;) {
+		e_down = (lv > 0 ? table_error(lv - 1, data) : DBL_MAX);
+		e_up = (lv < N_lesion_values - 1 ? table_error(lv + 1, data) : DBL_MAX);
+		*n_evaluated += 2;
+		if (e_down < e && e_down <= e_up) {
+			e = e_down;
+			lv--;
+		}
+		else if (e_up < e) {
+			e = e_up;
+			lv++;
+		}
+		else
+			return lv;
+	}
+}
+
+
+void fit_progression(const double baseline[N_TASKs], const double follow_up[N_TASKs], 
+	int *lv1, int *lv2, int *n_evaluated)
+{
+	int move[6][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 }, { -1, -1 }, { 1, 1 } };
+	double e, e_new;
+	int m, a, b, improved;
+
+	*n_evaluated = 0;
+	*lv1 = best_fit_in_score_table((double *) baseline);
+	*lv2 = descend_from(*lv1, follow_up, n_evaluated);
+	if (!progressed(*lv1, *lv2))
+		*lv2 = *lv1;
+
+	e = table_error(*lv1, baseline) + table_error(*lv2, follow_up);
+	do {
+		improved = 0;
+		for (m = 0; m < 6; m++) {
+			a = *lv1 + move[m][0];
+			b = *lv2 + move[m][1];
+			if (a < 0 || a >= N_lesion_values || b < 0 || b >= N_lesion_values || !progressed(a, b))
+				continue;
+			e_new = table_error(a, baseline) + table_error(b, follow_up);
+			*n_evaluated += 1;
+			if (e_new < e) {
+				e = e_new;
+				*lv1 = a;
+				*lv2 = b;
+				improved = 1;
+			}
+		}
+	} while (improved);
+}
+
+
+/* simulated scores at a lesion value between the table values */
+
+void interpolate_scores(double value, double score[N_TASKs])
+{
+	double *lesion = (WEIGHT_LESION ? WEIGHT_value : DECAY_value);
+	double x = (value - lesion[0]) / (lesion[1] - lesion[0]);
+	int i, t;
+
+	x = (x < 0.0 ? 0.0 : x > N_lesion_values - 1 ? N_lesion_values - 1 : x);
+	i = (int) x;
+	if (i == N_lesion_values - 1)
+		i--;
+	x -= i;
+	for (t = 0; t < N_TASKs; t++)
+		score[t] = (1.0 - x) * SCORE_TABLE[i][group][t] + x * SCORE_TABLE[i + 1][group][t];
+}
+
+
+void print_progression()
+{
+	double *lesion = (WEIGHT_LESION ? WEIGHT_value : DECAY_value);
+	char *study = (assessment == BRAMBATI_T2 ? "Brambati et al. (2015), baseline" 
+	                                         : "Rohrer et al. (2013), Mandelli et al. (2016), baseline");
+	double (*cases)[N_TASKs], *baseline;
+	double years = FOLLOW_UP_YEARS[assessment], rate, value, score[N_TASKs];
+	int lv1, lv2, n_evaluated, k;
+
+	/* the baseline of the group in STUDY_FILE; the groups without one have no follow up either */
+	if (study_cases(study, VARIANT_SITE_NAME[group], &cases) != 1) {
+		printf("Progression: no follow-up data\n");
+		return;
+	}
+	baseline = cases[0];
+
+	fit_progression(baseline, REAL_DATA[group], &lv1, &lv2, &n_evaluated);
+	rate = (lesion[lv2] - lesion[lv1]) / years;
+
+	printf("Progression fit: %s value %.2f -> %.2f (%+.3f per year)   MAE = %.2f (T1 %.2f, T2 %.2f)\n",
+		WEIGHT_LESION ? "weight" : "decay", lesion[lv1], lesion[lv2], rate,
+		(table_error(lv1, baseline) + table_error(lv2, REAL_DATA[group])) / 2.0,
+		table_error(lv1, baseline), table_error(lv2, REAL_DATA[group]));
+	printf("(follow up after %.1f years; %d lesion values evaluated after the baseline sweep)\n", 
+		years, n_evaluated);
+
+	for (k = 1; k <= N_PROJECTED_YEARs; k++) {
+		value = lesion[lv2] + rate * k;
+		value = (value < lesion[0] ? lesion[0] 
+		         : value > lesion[N_lesion_values - 1] ? lesion[N_lesion_values - 1] : value);
+		interpolate_scores(value, score);
+		printf("T2 + %d y: %5.2f   %5.2f         %5.2f        %5.2f \n", 
+			k, value, score[NAMING], score[COMPREHENSION], score[REPETITION]);
+	}
+}
+
+
+
+
+/*****************************
+ * LESION-SCORE LOOKUP TABLE *
+ *****************************/
+
+/*
+   The simulated scores as a function of the lesion value are the same for 
+   all assessments and patients, and smooth. They are precomputed once per 
+   variant and lesion type on a fine grid (N_TABLE_VALUEs values) and 
+   stored in LOOKUP_TABLE_FILE: a header with the rates, the time steps and
+   a checksum of the network, followed by the scores as doubles, mapped 
+   into memory as is. The table is rebuilt when it is missing or was made 
+   with other rates, steps, connections or lesion sites. A fit then scans the grid 
+   with linear interpolation and refines the best value between its 
+   neighbours by golden-section search, without running the simulator.
+*/
+
+const LOOKUP_HEADER *LOOKUP = NULL;
+const LOOKUP_SCORES *LOOKUP_SCORE = NULL;
+
+/* 
+   FNV-1a hash of the normal weight set and of one lesioned weight set per 
+   group, which covers the connection tables and the blocks and layers of 
+   each lesion site, as a studies file may change them.
+*/
+
+unsigned long long network_checksum(const double rate[N_RATEs])
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	const unsigned char *byte;
+	WEIGHT_SET w;
+	size_t i;
+	int g;
+
+	for (g = 0; g < N_GROUPs; g++) {
+		memset(&w, 0, sizeof(w));
+		get_rate_configuration(&w.config, rate);
+		if (g != NORMAL)
+			add_lesion(&w.config, g, 0.5, 1.33);
+		derive_weight_set(&w);
+		for (byte = (const unsigned char *) &w, i = 0; i < offsetof(WEIGHT_SET, propagator); i++) {
+			hash ^= byte[i];
+			hash *= 1099511628211ULL;
+		}
+	}
+	return hash;
+}
+
+
+/* a fresh header for the current rates and network */
+
+void get_lookup_header(LOOKUP_HEADER *h)
+{
+	int i;
+
+	memset(h, 0, sizeof(*h));
+	memcpy(h->magic, EXPONENTIAL_INTEGRATION ? "WPPARCX" : "WPPARC1", 8);
+	h->n_values = N_TABLE_VALUEs;
+	h->n_types = N_LESION_TYPEs;
+	h->n_groups = N_GROUPs;
+	h->n_tasks = N_TASKs;
+	h->n_steps = N_STEPs;
+	h->step_size = STEP_SIZE;
+	for (i = 0; i < N_RATEs; i++)
+		h->rate[i] = *RATE_VARIABLE[i];
+	h->lo[WEIGHT_TYPE] = 0.0;
+	h->hi[WEIGHT_TYPE] = 1.0;
+	h->lo[DECAY_TYPE] = 1.0;
+	h->hi[DECAY_TYPE] = 1.66;
+	h->network = network_checksum(h->rate);
+}
+
+
+int build_lookup_table(const char *file)
+{
+	static LOOKUP_SCORES score;
+	LOOKUP_HEADER h;
+	WEIGHT_SET w;
+	double normal[N_TASKs], target, relative;
+	char temp[FILENAME_MAX];
+	FILE *fp;
+	int t, n;
+
+	get_lookup_header(&h);
+	get_rate_configuration(&w.config, h.rate);
+	derive_weight_set(&w);
+	for (t = 0; t < N_TASKs; t++) {
+		run_fit_trial(&w, t, &target, &relative);
+		normal[t] = target - relative;
+	}
+
+	#pragma omp parallel for schedule(dynamic)
+	for (n = 0; n < N_LESION_TYPEs * N_GROUPs * N_TABLE_VALUEs; n++) {
+		int type = n / (N_GROUPs * N_TABLE_VALUEs), g = n / N_TABLE_VALUEs % N_GROUPs;
+		int i = n % N_TABLE_VALUEs, k;
+		double value = h.lo[type] + (h.hi[type] - h.lo[type]) * i / (N_TABLE_VALUEs - 1);
+		double tr, rr;
+		WEIGHT_SET wl;
+
+		get_rate_configuration(&wl.config, h.rate);
+		if (g != NORMAL)
+			add_lesion(&wl.config, g, type == WEIGHT_TYPE ? value : 1.0, type == DECAY_TYPE ? value : 1.0);
+		derive_weight_set(&wl);
+		for (k = 0; k < N_TASKs; k++) {
+			run_fit_trial(&wl, k, &tr, &rr);
+			score[type][g][i][k] = (tr - rr) / normal[k] * 100.0;
+		}
+	}
+
+	/* 
+	   serve() and other processes may have the old table mapped, so it is 
+	   written next to it and then replaces it as a whole 
+	*/
+	if (snprintf(temp, sizeof(temp), "%s.tmp", file) >= (int) sizeof(temp) || (fp = fopen(temp, "wb")) == NULL)
+		return 0;
+	n = (fwrite(&h, sizeof(h), 1, fp) == 1 && fwrite(score, sizeof(score), 1, fp) == 1);
+	n = (fclose(fp) == 0 && n);
+#ifdef _WIN32
+	if (n)
+		remove(file); /* rename() does not replace an existing file there */
+#endif
+	if (!n || rename(temp, file) != 0) {
+		remove(temp);
+		return 0;
+	}
+	return 1;
+}
+
+
+/* 
+   Maps a whole file read-only, and returns it and its size; NULL if it 
+   cannot be opened. Without mmap (Windows), the file is read instead.
+*/
+
+char *map_file(const char *file, size_t *size)
+{
+	char *data;
+#ifdef _WIN32
+	FILE *fp;
+	long n;
+
+	if ((fp = fopen(file, "rb")) == NULL)
+		return NULL;
+	if (fseek(fp, 0, SEEK_END) != 0 || (n = ftell(fp)) <= 0 || fseek(fp, 0, SEEK_SET) != 0 
+		|| (data = malloc(n)) == NULL) {
+		fclose(fp);
+		return NULL;
+	}
+	if (fread(data, n, 1, fp) != 1) {
+		free(data);
+		fclose(fp);
+		return NULL;
+	}
+	fclose(fp);
+	*size = n;
+#else
+	struct stat st;
+	int fd;
+
+	if ((fd = open(file, O_RDONLY)) < 0)
+		return NULL;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+		close(fd);
+		return NULL;
+	}
+	*size = st.st_size;
+	data = mmap(NULL, *size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return NULL;
+#endif
+	return data;
+}
+
+
+void unmap_file(char *data, size_t size)
+{
+#ifdef _WIN32
+	free(data);
+#else
+	munmap(data, size);
+#endif
+}
+
+
+/* maps the table of the file; 0 if it is missing or does not fit */
+
+int map_lookup_table(const char *file)
+{
+	LOOKUP_HEADER h;
+	size_t size;
+	char *data;
+
+	if ((data = map_file(file, &size)) == NULL)
+		return 0;
+
+	get_lookup_header(&h);
+	if (size != sizeof(LOOKUP_HEADER) + sizeof(LOOKUP_SCORES) || memcmp(data, &h, sizeof(h)) != 0) {
+		unmap_file(data, size);
+		return 0;
+	}
+
+	LOOKUP = (const LOOKUP_HEADER *) data;
+	LOOKUP_SCORE = (const LOOKUP_SCORES *) (data + sizeof(LOOKUP_HEADER));
+	return 1;
+}
+
+
+/* maps the table, building it first when needed; 0 if that fails */
+
+int get_lookup_table(FILE *log)
+{
+	if (LOOKUP != NULL || map_lookup_table(LOOKUP_TABLE_FILE))
+		return 1;
+	fprintf(log, "\nBuilding lookup table %s ...\n", LOOKUP_TABLE_FILE);
+	if (build_lookup_table(LOOKUP_TABLE_FILE) && map_lookup_table(LOOKUP_TABLE_FILE))
+		return 1;
+	fprintf(log, "Cannot write or map %s\n", LOOKUP_TABLE_FILE);
+	return 0;
+}
+
+
+/* scores of group g at a lesion value, interpolated */
+
+void lookup_scores(int type, int g, double value, double score[N_TASKs])
+{
+	double x = (value - LOOKUP->lo[type]) / (LOOKUP->hi[type] - LOOKUP->lo[type]) * (N_TABLE_VALUEs - 1);
+	int i, t;
+
+	x = (x < 0.0 ? 0.0 : x > N_TABLE_VALUEs - 1 ? N_TABLE_VALUEs - 1 : x);
+	i = (int) x;
+	if (i == N_TABLE_VALUEs - 1)
+		i--;
+	x -= i;
+	for (t = 0; t < N_TASKs; t++)
+		score[t] = (1.0 - x) * (*LOOKUP_SCORE)[type][g][i][t] + x * (*LOOKUP_SCORE)[type][g][i + 1][t];
+}
+
+
+double lookup_error(int type, int g, double value, const double data[N_TASKs])
+{
+	double score[N_TASKs];
+
+	lookup_scores(type, g, value, score);
+	return (fabs(data[NAMING] - score[NAMING]) + fabs(data[COMPREHENSION] - score[COMPREHENSION])
+	      + fabs(data[REPETITION] - score[REPETITION])) / 3.0;
+}
+
+
+/* best-fit lesion value of group g for the data; returns the MAE */
+
+double fit_with_lookup_table(int type, int g, const double data[N_TASKs], double *value)
+{
+	const double r = 0.61803398874989485;
+	double step = (LOOKUP->hi[type] - LOOKUP->lo[type]) / (N_TABLE_VALUEs - 1);
+	double a, b, x1, x2, e1, e2, e, best = DBL_MAX;
+	int i, k, n = 0;
+
+	for (i = 0; i < N_TABLE_VALUEs; i++) {
+		e = fabs(data[NAMING] - (*LOOKUP_SCORE)[type][g][i][NAMING])
+		  + fabs(data[COMPREHENSION] - (*LOOKUP_SCORE)[type][g][i][COMPREHENSION])
+		  + fabs(data[REPETITION] - (*LOOKUP_SCORE)[type][g][i][REPETITION]);
+		if (e < best) {
+			best = e;
+			n = i;
+		}
+	}
+
+	/* golden section between the neighbours of the best grid value */
+	a = LOOKUP->lo[type] + step * (n > 0 ? n - 1 : n);
+	b = LOOKUP->lo[type] + step * (n < N_TABLE_VALUEs - 1 ? n + 1 : n);
+	x1 = b - r * (b - a);
+	x2 = a + r * (b - a);
+	e1 = lookup_error(type, g, x1, data);
+	e2 = lookup_error(type, g, x2, data);
+	for (k = 0; k < 30; k++)
+		if (e1 <= e2) {
+			b = x2; x2 = x1; e2 = e1;
+			x1 = b - r * (b - a);
+			e1 = lookup_error(type, g, x1, data);
+		}
+		else {
+			a = x1; x1 = x2; e1 = e2;
+			x2 = a + r * (b - a);
+			e2 = lookup_error(type, g, x2, data);
+		}
+
+	*value = (e1 <= e2 ? x1 : x2);
+	e = (e1 <= e2 ? e1 : e2);
+	if (best / 3.0 <= e) {
+		*value = LOOKUP->lo[type] + step * n;
+		e = best / 3.0;
+	}
+	return e;
+}
+
+
+/* fits all assessments and the Janssen et al. cases from the table */
+
+void print_lookup_fits()
+{
+	char *name[N_GROUPs] = { "Normal", "Nonfluent/agrammatic", "Semantic", "Logopenic" };
+	double (*cases[N_GROUPs])[N_TASKs];
+	int n_cases[N_GROUPs];
+	int type = (WEIGHT_LESION ? WEIGHT_TYPE : DECAY_TYPE), g, i, n_fits = 0;
+	double value, mae, start, seconds;
+
+	for (g = NONFLUENT_AGRAMMATIC; g <= LOGOPENIC; g++)
+		n_cases[g] = janssen_cases(g, &cases[g]);
+
+	start = wall_time();
+	if (!get_lookup_table(stdout))
+		return;
+	printf("\nLookup table %s ready in %.3f s\n", LOOKUP_TABLE_FILE, wall_time() - start);
+
+	start = wall_time();
+	for (assessment = 0; assessment < N_ASSESSMENTs; assessment++) {
+		set_real_data_matrix();
+		printf("\nAssessment %d, best fit %s values from the lookup table\n", 
+			assessment, type == WEIGHT_TYPE ? "weight" : "decay");
+		for (g = NONFLUENT_AGRAMMATIC; g <= LOGOPENIC; g++, n_fits++) {
+			mae = fit_with_lookup_table(type, g, REAL_DATA[g], &value);
+			printf("%-22s value = %.4f   MAE = %.2f\n", name[g], value, mae);
+		}
+	}
+
+	printf("\nJanssen et al. (2022) cases\n");
+	for (g = NONFLUENT_AGRAMMATIC; g <= LOGOPENIC; g++)
+		for (i = 0; i < n_cases[g]; i++, n_fits++) {
+			mae = fit_with_lookup_table(type, g, cases[g][i], &value);
+			printf("%-22s case %2d   value = %.4f   MAE = %.2f\n", name[g], i + 1, value, mae);
+		}
+	seconds = wall_time() - start;
+
+	printf("\n%d fits in %.1f ms (%.1f microseconds per fit, printing included)\n", 
+		n_fits, seconds * 1000.0, seconds * 1e6 / n_fits);
+}
+
+
+
+
+/**************************
+ * NEAREST-PROFILE INDEX *
+ **************************/
+
+/*
+   Classification of patients by their nearest simulated profiles. The 
+   (naming, comprehension, repetition) scores of every lesion site, type 
+   and severity are simulated once and put in a k-d tree; a query returns 
+   the K_NEAREST profiles with the lowest MAE to the patient's scores, and 
+   the variant most of them imply (the Leyton et al. clusters are logopenic). 
+   The MAE is a scaled L1 distance, so a subtree is skipped when the 
+   distance to its splitting plane alone exceeds the worst profile found.
+*/
+
+PROFILE *PROFILES;    /* [N_PROFILEs], with CLASSIFY_CASES only */
+int *PROFILE_ORDER;   /* [N_PROFILEs], the k-d tree: the median of each range is its node */
+int KD_AXIS;
+
+char *SITE_NAME[N_SITEs] = { "Normal", "Nfa", "Sem", "Log", "Leyton1", "Leyton2", "Leyton3" };
+int SITE_VARIANT[N_SITEs] = { NORMAL, NONFLUENT_AGRAMMATIC, SEMANTIC_DEMENTIA, LOGOPENIC, 
+                              LOGOPENIC, LOGOPENIC, LOGOPENIC };
+
+
+double profile_distance(const double q[N_TASKs], int p)
+{
+	return (fabs(q[NAMING] - PROFILES[p].score[NAMING])
+	      + fabs(q[COMPREHENSION] - PROFILES[p].score[COMPREHENSION])
+	      + fabs(q[REPETITION] - PROFILES[p].score[REPETITION])) / 3.0;
+}
+
+
+int compare_on_axis(const void *a, const void *b)
+{
+	double x = PROFILES[*(const int *) a].score[KD_AXIS], y = PROFILES[*(const int *) b].score[KD_AXIS];
+
+	return (x < y ? -1 : x > y ? 1 : 0);
+}
+
+
+void kd_build(int lo, int hi, int depth)
+{
+	int mid = (lo + hi) / 2;
+
+	if (hi - lo < 2)
+		return;
+	KD_AXIS = depth % N_TASKs;
+	qsort(&PROFILE_ORDER[lo], hi - lo, sizeof(int), compare_on_axis);
+	kd_build(lo, mid, depth + 1);
+	kd_build(mid + 1, hi, depth + 1);
+}
+
+
+/* keeps the k nearest so far sorted by distance */
+
+void insert_nearest(int p, double d, int k, int nearest[], double distance[], int *n)
+{
+	int i;
+
+	if (*n == k && d >= distance[k - 1])
+		return;
+	for (i = (*n < k ? (*n)++ : k - 1); i > 0 && distance[i - 1] > d; i--) {
+		nearest[i] = nearest[i - 1];
+		distance[i] = distance[i - 1];
+	}
+	nearest[i] = p;
+	distance[i] = d;
+}
+
+
+void kd_search(int lo, int hi, int depth, const double q[N_TASKs], int k, 
+	int nearest[], double distance[], int *n)
+{
+	int mid = (lo + hi) / 2, axis = depth % N_TASKs, p;
+	double diff;
+
+	if (lo >= hi)
+		return;
+	p = PROFILE_ORDER[mid];
+	insert_nearest(p, profile_distance(q, p), k, nearest, distance, n);
+
+	diff = q[axis] - PROFILES[p].score[axis];
+	if (diff < 0.0) {
+		kd_search(lo, mid, depth + 1, q, k, nearest, distance, n);
+		if (*n < k || fabs(diff) / 3.0 < distance[k - 1])
+			kd_search(mid + 1, hi, depth + 1, q, k, nearest, distance, n);
+	}
+	else {
+		kd_search(mid + 1, hi, depth + 1, q, k, nearest, distance, n);
+		if (*n < k || fabs(diff) / 3.0 < distance[k - 1])
+			kd_search(lo, mid, depth + 1, q, k, nearest, distance, n);
+	}
+}
+
+
+/* the k nearest profiles, nearest first; returns their number */
+
+int nearest_profiles(const double q[N_TASKs], int k, int nearest[], double distance[])
+{
+	int n = 0;
+
+	kd_search(0, N_PROFILEs, 0, q, k, nearest, distance, &n);
+	return n;
+}
+
+
+int nearest_profiles_brute_force(const double q[N_TASKs], int k, int nearest[], double distance[])
+{
+	int p, n = 0;
+
+	for (p = 0; p < N_PROFILEs; p++)
+		insert_nearest(p, profile_distance(q, p), k, nearest, distance, &n);
+	return n;
+}
+
+
+/* 
+   The spacing of the lesion values of the run (see main()), 0.01 with the 
+   default 100 weight or 66 decay values, and the number of weight and 
+   decay values at that spacing. values= thus also refines the profiles 
+   and the lesion grid.
+*/
+
+void set_lesion_spacing()
+{
+	LESION_STEP = (DECAY_LESION ? 0.66 : 1.0) / N_lesion_values;
+	N_WEIGHT_PROFILEs = (int) (1.0 / LESION_STEP + 0.5);
+	N_DECAY_PROFILEs = (int) (0.66 / LESION_STEP + 0.5);
+	N_PROFILEs = (N_SITEs - 1) * (N_WEIGHT_PROFILEs + N_DECAY_PROFILEs);
+}
+
+
+void build_profile_index()
+{
+	WEIGHT_SET w;
+	double rate[N_RATEs], normal[N_TASKs], target, relative;
+	int i, p, t;
+
+	for (i = 0; i < N_RATEs; i++)
+		rate[i] = *RATE_VARIABLE[i];
+	get_rate_configuration(&w.config, rate);
+	derive_weight_set(&w);
+	for (t = 0; t < N_TASKs; t++) {
+		run_fit_trial(&w, t, &target, &relative);
+		normal[t] = target - relative;
+	}
+
+	/* per site, weight values 0.00, 0.01, ... and decay values 1.01, 1.02, ... by default */
+	#pragma omp parallel for schedule(dynamic)
+	for (p = 0; p < N_PROFILEs; p++) {
+		int site = 1 + p / (N_WEIGHT_PROFILEs + N_DECAY_PROFILEs), k = p % (N_WEIGHT_PROFILEs + N_DECAY_PROFILEs);
+		double tr, rr;
+		WEIGHT_SET wl;
+		int task;
+
+		PROFILES[p].site = site;
+		PROFILES[p].weight_lesion = (k < N_WEIGHT_PROFILEs);
+		PROFILES[p].value = (k < N_WEIGHT_PROFILEs ? LESION_STEP * k : 1.0 + LESION_STEP * (k - N_WEIGHT_PROFILEs + 1));
+
+		get_rate_configuration(&wl.config, rate);
+		add_lesion(&wl.config, site, PROFILES[p].weight_lesion ? PROFILES[p].value : 1.0, 
+		           PROFILES[p].weight_lesion ? 1.0 : PROFILES[p].value);
+		derive_weight_set(&wl);
+		for (task = 0; task < N_TASKs; task++) {
+			run_fit_trial(&wl, task, &tr, &rr);
+			PROFILES[p].score[task] = (tr - rr) / normal[task] * 100.0;
+		}
+	}
+
+	for (p = 0; p < N_PROFILEs; p++)
+		PROFILE_ORDER[p] = p;
+	kd_build(0, N_PROFILEs, 0);
+}
+
+
+/* variant implied by most of the nearest profiles, the nearest one on a tie */
+
+int implied_variant(const int nearest[], int n)
+{
+	int votes[N_GROUPs] = { 0 }, i, v, best;
+
+	for (i = 0; i < n; i++)
+		votes[SITE_VARIANT[PROFILES[nearest[i]].site]]++;
+	best = SITE_VARIANT[PROFILES[nearest[0]].site];
+	for (v = 0; v < N_GROUPs; v++)
+		if (votes[v] > votes[best])
+			best = v;
+	return best;
+}
+
+
+void classify_cases()
+{
+	char *variant_name[N_GROUPs] = { "Normal", "Nonfluent/agrammatic", "Semantic", "Logopenic" };
+	struct { char *name, *study; int variant; double (*data)[N_TASKs]; int n; } sets[5] = {
+		{ "Savage sem", "Savage et al. (2014), semantic cases", SEMANTIC_DEMENTIA },
+		{ "Gorno-Tempini log", "Gorno-Tempini et al. (2008), logopenic cases", LOGOPENIC },
+		{ "Janssen nfa", "Janssen et al. (2022), nonfluent/agrammatic cases", NONFLUENT_AGRAMMATIC },
+		{ "Janssen sem", "Janssen et al. (2022), semantic cases", SEMANTIC_DEMENTIA },
+		{ "Janssen log", "Janssen et al. (2022), logopenic cases", LOGOPENIC }
+	};
+	int *nearest, *check, k = (K_NEAREST < N_PROFILEs ? K_NEAREST : N_PROFILEs);
+	double *distance, *check_distance, start, tree_time, brute_time;
+	int s, i, j, n, v, n_cases = 0, n_agree = 0, n_differ = 0, r;
+
+	nearest = malloc(sizeof(int) * k);
+	check = malloc(sizeof(int) * k);
+	distance = malloc(sizeof(double) * k);
+	check_distance = malloc(sizeof(double) * k);
+	if (nearest == NULL || check == NULL || distance == NULL || check_distance == NULL) {
+		printf("\nCannot allocate the nearest profiles\n");
+		free(nearest);
+		free(check);
+		free(distance);
+		free(check_distance);
+		return;
+	}
+
+	for (s = 0; s < 5; s++)
+		sets[s].n = study_cases(sets[s].study, VARIANT_SITE_NAME[sets[s].variant], &sets[s].data);
+
+	start = wall_time();
+	build_profile_index();
+	printf("\nNEAREST PROFILES: %d simulated profiles indexed in %.3f s\n", N_PROFILEs, wall_time() - start);
+
+	for (s = 0; s < 5; s++)
+		for (i = 0; i < sets[s].n; i++, n_cases++) {
+			n = nearest_profiles(sets[s].data[i], k, nearest, distance);
+			v = implied_variant(nearest, n);
+			n_agree += (v == sets[s].variant);
+
+			printf("%-17s %2d: %-20s", sets[s].name, i + 1, variant_name[v]);
+			for (j = 0; j < n; j++)
+				printf(" %s %c%.2f (%.2f)", SITE_NAME[PROFILES[nearest[j]].site], 
+					PROFILES[nearest[j]].weight_lesion ? 'w' : 'd', PROFILES[nearest[j]].value, distance[j]);
+			printf("\n");
+
+			nearest_profiles_brute_force(sets[s].data[i], k, check, check_distance);
+			for (j = 0; j < n; j++)
+				n_differ += (check_distance[j] != distance[j]);
+		}
+	if (n_cases == 0)
+		printf("No cases in %s\n", STUDY_FILE);
+
+	/* timing, repeating all queries */
+	start = wall_time();
+	for (r = 0; r < 1000; r++)
+		for (s = 0; s < 5; s++)
+			for (i = 0; i < sets[s].n; i++)
+				nearest_profiles(sets[s].data[i], k, nearest, distance);
+	tree_time = (wall_time() - start) / (1000.0 * (n_cases > 0 ? n_cases : 1));
+
+	start = wall_time();
+	for (r = 0; r < 1000; r++)
+		for (s = 0; s < 5; s++)
+			for (i = 0; i < sets[s].n; i++)
+				nearest_profiles_brute_force(sets[s].data[i], k, nearest, distance);
+	brute_time = (wall_time() - start) / (1000.0 * (n_cases > 0 ? n_cases : 1));
+
+	printf("Implied variant is the study's variant for %d of %d cases\n", n_agree, n_cases);
+	printf("%d nearest per query: k-d tree %.2f microseconds, brute force %.2f microseconds (%s)\n", 
+		k, tree_time * 1e6, brute_time * 1e6, n_differ ? "RESULTS DIFFER" : "same results");
+
+	free(nearest);
+	free(check);
+	free(distance);
+	free(check_distance);
+}
+
+
+
+
+/*******************
+ * FITTING SERVICE *
+ *******************/
+
+/*
+   With SERVE set, the program runs as a long-lived fitting service on 
+   stdin and stdout, instead of printing the studies; it can be put on a 
+   local socket with, e.g., socat TCP-LISTEN:7000,fork EXEC:./wpparc. The 
+   lookup table is loaded (or built) once at start. Every input line holds 
+   one or more triples of naming, comprehension and repetition scores, and 
+   each triple gets one line back: per variant the best-fit lesion value, 
+   the MAE and the likelihood of the variant, followed by the most likely 
+   variant. The likelihoods assume Laplace noise with scale SERVICE_NOISE 
+   on each score. "stats" prints the latency metrics, "quit" ends; the 
+   metrics also go to stderr at the end.
+*/
+
+#define N_LATENCY_BINs 32 /* powers of 2 microseconds */
+
+double SERVICE_COLD_START;               /* s, until the table is ready */
+long SERVICE_QUERIES, SERVICE_REQUESTS;
+double SERVICE_LATENCY_SUM, SERVICE_LATENCY_MAX; /* s, per request */
+long SERVICE_LATENCY_COUNT[N_LATENCY_BINs];
+
+
+/* upper bound of the bin holding fraction q of the requests, in microseconds */
+
+double latency_percentile(double q)
+{
+	long sum = 0;
+	int i;
+
+	for (i = 0; i < N_LATENCY_BINs - 1; i++)
+		if ((sum += SERVICE_LATENCY_COUNT[i]) >= q * SERVICE_REQUESTS)
+			break;
+	return ldexp(1.0, i);
+}
+
+
+void print_service_metrics(FILE *fp)
+{
+	fprintf(fp, "cold start %.1f ms; %ld requests, %ld patients; latency per request: "
+		"mean %.1f us, p50 <= %.0f us, p99 <= %.0f us, max %.1f us\n",
+		SERVICE_COLD_START * 1000.0, SERVICE_REQUESTS, SERVICE_QUERIES,
+		SERVICE_REQUESTS ? SERVICE_LATENCY_SUM * 1e6 / SERVICE_REQUESTS : 0.0,
+		latency_percentile(0.50), latency_percentile(0.99), SERVICE_LATENCY_MAX * 1e6);
+	fflush(fp);
+}
+
+
+/* 1 if all scores are numbers from -100 to 150, the range of the simulations */
+
+int valid_scores(const double data[N_TASKs])
+{
+	int t;
+
+	for (t = 0; t < N_TASKs; t++)
+		if (!(data[t] >= -100.0 && data[t] <= 150.0)) /* also NaN */
+			return 0;
+	return 1;
+}
+
+
+void answer_query(const double data[N_TASKs], char *answer, size_t size)
+{
+	char *name[N_GROUPs] = { "normal", "nfa", "sem", "log" };
+	int type = (WEIGHT_LESION ? WEIGHT_TYPE : DECAY_TYPE), g, best = NONFLUENT_AGRAMMATIC;
+	double value[N_GROUPs], mae[N_GROUPs], likelihood[N_GROUPs], sum = 0.0;
+	size_t n = 0;
+
+	if (!valid_scores(data)) {
+		snprintf(answer, size, "error: scores must be from -100 to 150\n");
+		return;
+	}
+
+	for (g = NONFLUENT_AGRAMMATIC; g <= LOGOPENIC; g++) {
+		mae[g] = fit_with_lookup_table(type, g, data, &value[g]);
+		if (mae[g] < mae[best])
+			best = g;
+	}
+	/* relative to the best variant, so that nothing underflows */
+	for (g = NONFLUENT_AGRAMMATIC; g <= LOGOPENIC; g++)
+		sum += (likelihood[g] = exp(-N_TASKs * (mae[g] - mae[best]) / SERVICE_NOISE));
+	for (g = NONFLUENT_AGRAMMATIC; g <= LOGOPENIC && n < size; g++)
+		n += snprintf(answer + n, size - n, "%s %.4f %.2f %.3f  ", name[g], value[g], mae[g], likelihood[g] / sum);
+	if (n < size)
+		snprintf(answer + n, size - n, "best %s\n", name[best]);
+}
+
+
+int serve()
+{
+	static char line[65536], answer[256];
+	double start = wall_time(), data[N_TASKs], x;
+	char *p, *end;
+	int n, us;
+
+	if (!get_lookup_table(stderr))
+		return 1;
+	SERVICE_COLD_START = wall_time() - start;
+	fprintf(stderr, "ready: ");
+	print_service_metrics(stderr);
+
+	while (fgets(line, sizeof(line), stdin) != NULL) {
+		if (strncmp(line, "quit", 4) == 0)
+			break;
+		if (strncmp(line, "stats", 5) == 0) {
+			print_service_metrics(stdout);
+			continue;
+		}
+
+		start = wall_time();
+		for (p = line, n = 0; x = strtod(p, &end), end != p; p = end, n++) {
+			data[n % N_TASKs] = x;
+			if (n % N_TASKs == N_TASKs - 1) {
+				answer_query(data, answer, sizeof(answer));
+				fputs(answer, stdout);
+				SERVICE_QUERIES++;
+			}
+		}
+		if (n == 0 || n % N_TASKs != 0)
+			printf("error: expected naming, comprehension and repetition scores\n");
+		fflush(stdout);
+
+		start = wall_time() - start;
+		SERVICE_REQUESTS++;
+		SERVICE_LATENCY_SUM += start;
+		if (start > SERVICE_LATENCY_MAX)
+			SERVICE_LATENCY_MAX = start;
+		for (us = 0; us < N_LATENCY_BINs - 1 && ldexp(1.0, us) < start * 1e6; us++)
+			;
+		SERVICE_LATENCY_COUNT[us]++;
+	}
+
+	print_service_metrics(stderr);
+	return 0;
+}
+
+
+
+
+/********************
+ * PATIENT REGISTRY *
+ ********************/
+
+/*
+   Fits a registry of patients, read as a CSV stream with one patient per 
+   row (ID, variant, naming, comprehension, repetition), against the shared 
+   lookup table, without any patient in the source. Rows are read in chunks 
+   of REGISTRY_CHUNK, fitted in parallel (with OpenMP) and written in their 
+   input order to REGISTRY_FITS_FILE, so memory stays bounded however large 
+   the registry is. A variant is nfa, sem or log (or 1 - 3, or the full 
+   names); an empty or unknown variant ("?") is fitted to all three and the 
+   best one is reported. A first row with text in all score fields is the 
+   header and is skipped; any other row that cannot be read, or that is 
+   longer than a line buffer, is reported as such in the output.
+*/
+
+#define REGISTRY_CHUNK 4096
+
+
+/* NONFLUENT_AGRAMMATIC ... LOGOPENIC, -1 if unknown, -2 if not a variant */
+
+int parse_variant(const char *text)
+{
+	char *name[][4] = { { "", "", "", "" }, { "1", "nfa", "nonfluent", "agrammatic" }, 
+	                    { "2", "sem", "semantic", "svppa" }, { "3", "log", "logopenic", "lvppa" } };
+	char word[32];
+	int g, i;
+
+	for (i = 0; i < 31 && text[i] != '\0'; i++)
+		word[i] = (text[i] >= 'A' && text[i] <= 'Z' ? text[i] - 'A' + 'a' : text[i]);
+	word[i] = '\0';
+
+	if (word[0] == '\0' || strcmp(word, "?") == 0 || strcmp(word, "unknown") == 0)
+		return -1;
+	for (g = NONFLUENT_AGRAMMATIC; g <= LOGOPENIC; g++)
+		for (i = 0; i < 4; i++)
+			if (strncmp(word, name[g][i], strlen(name[g][i])) == 0 && (i > 0 || word[1] == '\0'))
+				return g;
+	if (strcmp(word, "nfvppa") == 0)
+		return NONFLUENT_AGRAMMATIC;
+	return -2;
+}
+
+
+/* 
+   Splits a row at its commas and trims the fields of blanks and quotes; 
+   returns the number of fields, 0 if it is not 2 + N_TASKs (then only the 
+   first one is sure to be set). 
+*/
+
+int split_registry_row(char *line, char *field[2 + N_TASKs])
+{
+	char *end;
+	int n, t;
+
+	for (n = 0; n < 2 + N_TASKs && line != NULL; n++) {
+		field[n] = line;
+		if ((line = strchr(line, ',')) != NULL)
+			*line++ = '\0';
+	}
+	for (t = 0; t < n; t++) {
+		while (*field[t] == ' ' || *field[t] == '\t' || *field[t] == '"')
+			field[t]++;
+		for (end = field[t] + strlen(field[t]); 
+		     end > field[t] && strchr(" \t\r\n\"", end[-1]) != NULL; end--)
+			;
+		*end = '\0';
+	}
+	return (n == 2 + N_TASKs && line == NULL ? n : 0);
+}
+
+
+/* 1 if every score field of the row is text, not a number, as in a header */
+
+int registry_header(char *line)
+{
+	char *field[2 + N_TASKs], *end;
+	int t;
+
+	if (split_registry_row(line, field) == 0)
+		return 0;
+	for (t = 0; t < N_TASKs; t++) {
+		strtod(field[2 + t], &end);
+		if (field[2 + t][0] == '\0' || end != field[2 + t])
+			return 0;
+	}
+	return 1;
+}
+
+
+void parse_registry_row(char *line, REGISTRY_ROW *r)
+{
+	char *field[2 + N_TASKs], *end;
+	int t;
+
+	r->error = NULL;
+	if (split_registry_row(line, field) == 0) {
+		snprintf(r->id, sizeof(r->id), "%s", field[0]);
+		r->error = "expected ID, variant, naming, comprehension, repetition";
+		return;
+	}
+
+	snprintf(r->id, sizeof(r->id), "%s", field[0]);
+	if ((r->variant = parse_variant(field[1])) == -2)
+		r->error = "unknown variant";
+	for (t = 0; t < N_TASKs && r->error == NULL; t++) {
+		r->data[t] = strtod(field[2 + t], &end);
+		if (end == field[2 + t] || *end != '\0')
+			r->error = "scores must be numbers";
+	}
+	if (r->error == NULL && !valid_scores(r->data))
+		r->error = "scores must be from -100 to 150";
+}
+
+
+void fit_registry_row(REGISTRY_ROW *r)
+{
+	int type = (WEIGHT_LESION ? WEIGHT_TYPE : DECAY_TYPE), g;
+	double value, mae;
+
+	if (r->error != NULL)
+		return;
+	if (r->variant >= 0) {
+		r->mae = fit_with_lookup_table(type, r->variant, r->data, &r->value);
+		return;
+	}
+	for (r->mae = DBL_MAX, g = NONFLUENT_AGRAMMATIC; g <= LOGOPENIC; g++)
+		if ((mae = fit_with_lookup_table(type, g, r->data, &value)) < r->mae) {
+			r->mae = mae;
+			r->value = value;
+			r->variant = g;
+		}
+}
+
+
+int fit_registry()
+{
+	char *name[N_GROUPs] = { "normal", "nfa", "sem", "log" };
+	static char line[REGISTRY_CHUNK][512], first[512];
+	static REGISTRY_ROW row[REGISTRY_CHUNK];
+	static int too_long[REGISTRY_CHUNK];
+	FILE *in, *out;
+	double start, table_time;
+	long n_rows = 0, n_errors = 0, row_number = 0;
+	int n, i, c, length, header_checked = 0;
+
+	start = wall_time();
+	if (!get_lookup_table(stdout))
+		return 1;
+	table_time = wall_time() - start;
+
+	if ((in = fopen(REGISTRY_FILE, "r")) == NULL) {
+		fprintf(stderr, "cannot read %s\n", REGISTRY_FILE);
+		return 1;
+	}
+	if ((out = fopen(REGISTRY_FITS_FILE, "w")) == NULL) {
+		fprintf(stderr, "cannot write %s\n", REGISTRY_FITS_FILE);
+		fclose(in);
+		return 1;
+	}
+	fprintf(out, "id,variant,%s_value,mae,error\n", WEIGHT_LESION ? "weight" : "decay");
+
+	start = wall_time();
+	for (;;) {
+		for (n = 0; n < REGISTRY_CHUNK && fgets(line[n], sizeof(line[n]), in) != NULL; ) {
+			row_number++;
+
+			/* a row that does not fit is skipped up to its end, and reported */
+			length = strlen(line[n]);
+			too_long[n] = 0;
+			if (length == (int) sizeof(line[n]) - 1 && line[n][length - 1] != '\n') {
+				while ((c = getc(in)) != EOF && c != '\n')
+					too_long[n] = 1;
+			}
+
+			if (!too_long[n] && strspn(line[n], " \t\r\n") == length)
+				continue; /* blank */
+			if (!header_checked) {
+				header_checked = 1;
+				if (!too_long[n] && registry_header(strcpy(first, line[n])))
+					continue;
+			}
+			n++;
+		}
+		if (n == 0)
+			break;
+
+		#pragma omp parallel for schedule(static)
+		for (i = 0; i < n; i++) {
+			parse_registry_row(line[i], &row[i]);
+			if (too_long[i])
+				row[i].error = "row longer than 511 characters";
+			fit_registry_row(&row[i]);
+		}
+
+		for (i = 0; i < n; i++) {
+			if (row[i].error != NULL) {
+				fprintf(out, "%s,,,,\"%s\"\n", row[i].id, row[i].error);
+				n_errors++;
+			} else
+				fprintf(out, "%s,%s,%.4f,%.2f,\n", row[i].id, name[row[i].variant], row[i].value, row[i].mae);
+		}
+		n_rows += n;
+	}
+	start = wall_time() - start;
+
+	fclose(in);
+	fclose(out);
+	printf("\n%ld patients of %s fitted in %.3f s (%.0f patients/s), %ld rows with errors, "
+		"results in %s\n", n_rows, REGISTRY_FILE, start, start > 0.0 ? n_rows / start : 0.0, 
+		n_errors, REGISTRY_FITS_FILE);
+	printf("lookup table %s ready in %.3f s\n", LOOKUP_TABLE_FILE, table_time);
+	return 0;
+}
+
+
+
+
+/****************
+ * RESULT QUEUE *
+ ****************/
+
+/*
+   Output of the per-patient results as a pipeline stage. The simulating 
+   threads push fixed-size records (a batch of patients) into a bounded 
+   lock-free queue, and one writer thread takes them out, formats them and 
+   writes them in large blocks, so that formatting and file I/O do not stall 
+   the simulation. The queue is a ring of N_QUEUE_SLOTs slots with a 
+   sequence number each (after Vyukov): a producer claims a slot by 
+   advancing the tail with compare-and-swap, fills it and publishes it by 
+   setting its sequence; the single consumer frees it again. A producer 
+   only waits when the ring is full, i.e., when the disk cannot keep up. 
+   The writer sleeps on a condition variable while the ring is empty, and 
+   a producer only takes the mutex to wake it when it is asleep. 
+   Without threads and atomics (Windows, or an old compiler), a record is 
+   formatted and written on the spot. Older C libraries need -pthread.
+*/
+
+#define N_QUEUE_SLOTs 256 /* a power of two */
+#define WRITE_BLOCK (1 << 18) /* bytes written at once */
+#define MAX_RECORD_TEXT (BATCH * 128) /* bytes of a formatted record at most */
+
+FILE *RESULT_FILE;
+char *RESULT_TEXT; /* WRITE_BLOCK + MAX_RECORD_TEXT */
+size_t RESULT_TEXT_USED;
+long N_RESULTs_WRITTEN;
+
+#ifdef RESULT_THREAD
+typedef struct {
+	atomic_size_t sequence;
+	PATIENT_RECORD record;
+} QUEUE_SLOT;
+
+QUEUE_SLOT *QUEUE;
+atomic_size_t QUEUE_TAIL; /* next slot to claim, shared by the producers */
+size_t QUEUE_HEAD; /* next slot to take, the writer's own */
+atomic_int WRITER_DONE;
+atomic_int WRITER_ASLEEP; /* set by the writer, under WRITER_MUTEX, before it waits */
+atomic_long N_PRODUCER_WAITs; /* pushes that found the ring full */
+pthread_t WRITER;
+pthread_mutex_t WRITER_MUTEX = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t WRITER_WAKE = PTHREAD_COND_INITIALIZER;
+#endif
+
+
+/* one line per patient: variant, patient, lesion values of the three sites, scores */
+
+size_t format_patient_record(char *text, const PATIENT_RECORD *r)
+{
+	char *name[N_GROUPs] = { "Normal", "Nonfluent/agrammatic", "Semantic", "Logopenic" };
+	size_t used = 0;
+	int b;
+
+	for (b = 0; b < BATCH; b++)
+		used += sprintf(text + used, "%s,%ld,%.4f,%.4f,%.4f,%.2f,%.2f,%.2f\n", name[r->variant], 
+			r->batch * BATCH + b, r->lesion[NONFLUENT_AGRAMMATIC][b], r->lesion[SEMANTIC_DEMENTIA][b], 
+			r->lesion[LOGOPENIC][b], r->score[NAMING][b], r->score[COMPREHENSION][b], 
+			r->score[REPETITION][b]);
+	return used;
+}
+
+
+/* formats a record into the pending text, and writes that out once a block is full */
+
+void write_result(const PATIENT_RECORD *r)
+{
+	RESULT_TEXT_USED += format_patient_record(RESULT_TEXT + RESULT_TEXT_USED, r);
+	N_RESULTs_WRITTEN += BATCH;
+	if (RESULT_TEXT_USED >= WRITE_BLOCK) {
+		fwrite(RESULT_TEXT, 1, RESULT_TEXT_USED, RESULT_FILE);
+		RESULT_TEXT_USED = 0;
+	}
+}
+
+
+#ifdef RESULT_THREAD
+/* takes the oldest record out of the queue; 0 if it is empty */
+
+int pop_result(PATIENT_RECORD *r)
+{
+	QUEUE_SLOT *slot = &QUEUE[QUEUE_HEAD & (N_QUEUE_SLOTs - 1)];
+
+	if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != QUEUE_HEAD + 1)
+		return 0;
+	*r = slot->record;
+	atomic_store_explicit(&slot->sequence, QUEUE_HEAD + N_QUEUE_SLOTs, memory_order_release);
+	QUEUE_HEAD++;
+	return 1;
+}
+
+
+/* 
+   The writer thread: drains the queue until the producers are done and it 
+   is empty. Before it sleeps, it announces so and looks at the queue once 
+   more; a producer publishes before it looks at WRITER_ASLEEP (both in 
+   sequential consistency), so one of the two always sees the other.
+*/
+
+void *result_writer(void *unused)
+{
+	PATIENT_RECORD r;
+	int done;
+
+	for (;;) {
+		done = atomic_load_explicit(&WRITER_DONE, memory_order_acquire);
+		if (pop_result(&r)) {
+			write_result(&r);
+			continue;
+		}
+		if (done)
+			break;
+
+		pthread_mutex_lock(&WRITER_MUTEX);
+		atomic_store(&WRITER_ASLEEP, 1);
+		atomic_thread_fence(memory_order_seq_cst);
+		if (pop_result(&r)) {
+			atomic_store(&WRITER_ASLEEP, 0);
+			pthread_mutex_unlock(&WRITER_MUTEX);
+			write_result(&r);
+			continue;
+		}
+		if (!atomic_load(&WRITER_DONE))
+			pthread_cond_wait(&WRITER_WAKE, &WRITER_MUTEX);
+		atomic_store(&WRITER_ASLEEP, 0);
+		pthread_mutex_unlock(&WRITER_MUTEX);
+	}
+	return unused;
+}
+
+
+/* wakes the writer if it sleeps on an empty queue */
+
+void wake_result_writer()
+{
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load(&WRITER_ASLEEP)) {
+		pthread_mutex_lock(&WRITER_MUTEX);
+		pthread_cond_signal(&WRITER_WAKE);
+		pthread_mutex_unlock(&WRITER_MUTEX);
+	}
+}
+#endif
+
+
+/* opens the file and starts the writer; 0 if that fails */
+
+int start_result_writer(const char *file)
+{
+#ifdef RESULT_THREAD
+	size_t i;
+#endif
+
+	if ((RESULT_FILE = fopen(file, "w")) == NULL || (RESULT_TEXT = malloc(WRITE_BLOCK + MAX_RECORD_TEXT)) == NULL) {
+		fprintf(stderr, "cannot write %s\n", file);
+		if (RESULT_FILE != NULL)
+			fclose(RESULT_FILE);
+		return 0;
+	}
+	fprintf(RESULT_FILE, "variant,patient,lesion_nfa_site,lesion_sem_site,lesion_log_site,"
+		"naming,comprehension,repetition\n");
+	RESULT_TEXT_USED = 0;
+	N_RESULTs_WRITTEN = 0;
+
+#ifdef RESULT_THREAD
+	if ((QUEUE = malloc(sizeof(QUEUE_SLOT) * N_QUEUE_SLOTs)) == NULL) {
+		fprintf(stderr, "cannot allocate the result queue\n");
+		fclose(RESULT_FILE);
+		free(RESULT_TEXT);
+		return 0;
+	}
+	for (i = 0; i < N_QUEUE_SLOTs; i++)
+		atomic_init(&QUEUE[i].sequence, i);
+	atomic_init(&QUEUE_TAIL, 0);
+	QUEUE_HEAD = 0;
+	atomic_init(&WRITER_DONE, 0);
+	atomic_init(&WRITER_ASLEEP, 0);
+	atomic_init(&N_PRODUCER_WAITs, 0);
+	if (pthread_create(&WRITER, NULL, result_writer, NULL) != 0) {
+		fprintf(stderr, "cannot start the result writer\n");
+		fclose(RESULT_FILE);
+		free(RESULT_TEXT);
+		free(QUEUE);
+		return 0;
+	}
+#endif
+	return 1;
+}
+
+
+/* hands a record to the writer; called by any number of threads at once */
+
+void push_result(const PATIENT_RECORD *r)
+{
+#ifdef RESULT_THREAD
+	QUEUE_SLOT *slot;
+	size_t tail = atomic_load_explicit(&QUEUE_TAIL, memory_order_relaxed);
+	long difference;
+
+	for (;;) {
+		slot = &QUEUE[tail & (N_QUEUE_SLOTs - 1)];
+		difference = (long) (atomic_load_explicit(&slot->sequence, memory_order_acquire) - tail);
+		if (difference == 0) {
+			if (atomic_compare_exchange_weak_explicit(&QUEUE_TAIL, &tail, tail + 1, 
+			                                          memory_order_relaxed, memory_order_relaxed))
+				break;
+		} else if (difference < 0) { /* full: the writer has not freed the slot yet */
+			atomic_fetch_add_explicit(&N_PRODUCER_WAITs, 1, memory_order_relaxed);
+			sched_yield();
+			tail = atomic_load_explicit(&QUEUE_TAIL, memory_order_relaxed);
+		} else
+			tail = atomic_load_explicit(&QUEUE_TAIL, memory_order_relaxed);
+	}
+	slot->record = *r;
+	atomic_store_explicit(&slot->sequence, tail + 1, memory_order_release);
+	wake_result_writer();
+#else
+	#pragma omp critical
+	write_result(r);
+#endif
+}
+
+
+/* waits for the writer to drain the queue, and closes the file */
+
+void stop_result_writer()
+{
+	double start = wall_time();
+
+#ifdef RESULT_THREAD
+	atomic_store(&WRITER_DONE, 1);
+	wake_result_writer();
+	pthread_join(WRITER, NULL);
+	free(QUEUE);
+#endif
+	fwrite(RESULT_TEXT, 1, RESULT_TEXT_USED, RESULT_FILE);
+	fclose(RESULT_FILE);
+	free(RESULT_TEXT);
+
+	printf("\n%ld patients written to %s (%.3f s to drain the queue", N_RESULTs_WRITTEN, PATIENT_FILE, 
+		wall_time() - start);
+#ifdef RESULT_THREAD
+	printf(", %ld waits on a full queue)\n", atomic_load(&N_PRODUCER_WAITs));
+#else
+	printf(", written without a background thread)\n");
+#endif
+}
+
+
+
+
+/*******************************
+ * VIRTUAL PATIENT POPULATIONS *
+ *******************************/
+
+/*
+   Simulates N_VIRTUAL_PATIENTs patients per variant, with lesions drawn 
+   from the POP_ distributions, and aggregates their scores on the fly 
+   (sums and a histogram), so nothing is stored per patient. Patients are 
+   simulated in batches of BATCH: every weight of a patient is a weight of 
+   the rate-only weight set times a lesion factor of its block, so a batch 
+   shares the weights, and only the block factors and retention differ per 
+   patient. The batch is the innermost loop, which the compiler vectorizes, 
+   and batches run in parallel (with OpenMP).
+*/
+
+#define N_SCORE_BINs 1000 /* histogram of scores, from -100 to 150 */
+#define SCORE_BIN(x) ((int) ((((x) < -100.0 ? -100.0 : (x) > 149.99 ? 149.99 : (x)) + 100.0) * 4.0))
+
+
+/* Box-Muller, using next_random() */
+
+double sample_normal(unsigned long long *state)
+{
+	double u1 = ((next_random(state) >> 11) + 1.0) * (1.0 / 9007199254740993.0);
+	double u2 = (next_random(state) >> 11) * (1.0 / 9007199254740992.0);
+
+	return sqrt(-2.0 * log(u1)) * cos(2.0 * 3.14159265358979323846 * u2);
+}
+
+
+double wall_time()
+{
+#ifdef _OPENMP
+	return omp_get_wtime();
+#else
+	return (double) clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+
+/* in[i][b] += factor[b] * sum over j of weight[i][j] * from[j][b] */
+
+void batch_spread(double (*in)[BATCH], const double *weight, int n_to, int n_from, 
+	double (*from)[BATCH], const double *factor)
+{
+	double sum[BATCH], wij;
+	int i, j, b;
+
+	for (i = 0; i < n_to; i++) {
+		for (b = 0; b < BATCH; b++)
+			sum[b] = 0.0;
+		for (j = 0; j < n_from; j++) {
+			wij = weight[i * n_from + j];
+			if (wij == 0.0)
+				continue;
+			for (b = 0; b < BATCH; b++)
+				sum[b] += wij * from[j][b];
+		}
+		for (b = 0; b < BATCH; b++)
+			in[i][b] += factor[b] * sum[b];
+	}
+}
+
+
+/* act[i][b] = act[i][b] * keep[b] + in[i][b] */
+
+void batch_update(double (*act)[BATCH], double (*in)[BATCH], int n, const double *keep)
+{
+	int i, b;
+
+	for (i = 0; i < n; i++)
+		for (b = 0; b < BATCH; b++)
+			act[i][b] = act[i][b] * keep[b] + in[i][b];
+}
+
+
+/* draws the lesion values of BATCH patients of a variant, per site */
+
+void sample_lesions(int variant, unsigned long long *state, double lesion[N_GROUPs][BATCH])
+{
+	double lv, lo, hi;
+	int site, b;
+
+	/* between maximal damage and none */
+	lo = (WEIGHT_LESION ? WEIGHT_value[0] : 1.0);
+	hi = (WEIGHT_LESION ? 1.0 : DECAY_value[N_lesion_values - 1]);
+
+	for (b = 0; b < BATCH; b++)
+		for (site = NONFLUENT_AGRAMMATIC; site <= LOGOPENIC; site++) {
+			if (site == variant)
+				lv = POP_MEAN[variant] + POP_SD[variant] * sample_normal(state);
+			else if (WEIGHT_LESION)
+				lv = 1.0 - fabs(POP_MIX_SD[variant] * sample_normal(state));
+			else
+				lv = 1.0 + fabs(POP_MIX_SD[variant] * sample_normal(state));
+			lesion[site][b] = (lv < lo ? lo : lv > hi ? hi : lv);
+		}
+}
+
+
+void simulate_batch(const WEIGHT_SET *w, const double normal[N_TASKs], int variant, 
+	unsigned long long *state, double lesion[N_GROUPs][BATCH], double score[N_TASKs][BATCH])
+{
+	sample_lesions(variant, state, lesion);
+	simulate_lesion_batch(w, normal, lesion, WEIGHT_LESION, score);
+}
+
+
+/* 
+   Scores of BATCH networks with the given lesion values at the three 
+   variant sites (weight or decay factors); the weight set w holds the 
+   current rates without lesion, normal[] the summed target minus relative 
+   activation of the normal network.
+*/
+
+void simulate_lesion_batch(const WEIGHT_SET *w, const double normal[N_TASKs], 
+	double lesion[N_GROUPs][BATCH], int weight_lesion, double score[N_TASKs][BATCH])
+{
+	static BATCH_LAYERS act, in;
+	#pragma omp threadprivate(act, in)
+	double f[N_BLOCKs][BATCH], keep[N_LAYERs][BATCH];
+	int i, b, task, s;
+
+	if (PRECISION != DOUBLE_PRECISION) {
+		simulate_lesion_batch_float(w, normal, lesion, weight_lesion, PRECISION == MIXED_PRECISION, score);
+		return;
+	}
+
+	batch_lesion_factors(w, lesion, weight_lesion, f, keep);
+
+	for (task = 0; task < N_TASKs; task++) {
+
+		memset(&act, 0, sizeof(act));
+		for (b = 0; b < BATCH; b++)
+			score[task][b] = 0.0;
+
+		for (s = 0; s < N_STEPs; s++) {
+			memset(&in, 0, sizeof(in));
+
+			/* external input, as in get_external_input() */
+			if (task == NAMING) {
+				if (s * STEP_SIZE < PICTURE_DURATION)
+					for (b = 0; b < BATCH; b++)
+						in.C[CAT][b] += w->picture_input * f[PICTURE_BLOCK][b];
+				if (s * STEP_SIZE >= CYCLE_TIME && s * STEP_SIZE < CYCLE_TIME + PICTURE_DURATION)
+					for (b = 0; b < BATCH; b++)
+						in.C[CAT][b] += w->extin;
+			}
+			else {
+				i = (s * STEP_SIZE < SEGMENT_DURATION ? pK 
+				     : s * STEP_SIZE < 2 * SEGMENT_DURATION ? pE 
+				     : s * STEP_SIZE < 3 * SEGMENT_DURATION ? pT : -1);
+				if (i >= 0)
+					for (b = 0; b < BATCH; b++)
+						in.iP[i][b] += w->extin;
+			}
+
+			/* internal input, as in get_internal_input() */
+			batch_spread(in.C, &w->CC[0][0], N_CONCEPTs, N_CONCEPTs, act.C, f[CC_BLOCK]);
+			batch_spread(in.C, &w->LC[0][0], N_CONCEPTs, N_LEMMAs, act.L, f[LC_BLOCK]);
+			batch_spread(in.L, &w->CL[0][0], N_LEMMAs, N_CONCEPTs, act.C, f[CL_BLOCK]);
+			batch_spread(in.L, &w->iML[0][0], N_LEMMAs, N_MORPHEMEs, act.iM, f[iML_BLOCK]);
+			batch_spread(in.M, &w->LM[0][0], N_MORPHEMEs, N_LEMMAs, act.L, f[LM_BLOCK]);
+			batch_spread(in.M, &w->iMM[0][0], N_MORPHEMEs, N_MORPHEMEs, act.iM, f[iMM_BLOCK]);
+			batch_spread(in.oP, &w->MP[0][0], N_PHONEMEs, N_MORPHEMEs, act.M, f[MP_BLOCK]);
+			batch_spread(in.oP, &w->iPoP[0][0], N_PHONEMEs, N_PHONEMEs, act.iP, f[iPoP_BLOCK]);
+			batch_spread(in.S, &w->PS[0][0], N_SYLLABLEs, N_PHONEMEs, act.oP, f[PS_BLOCK]);
+			batch_spread(in.iP, &w->oPiP[0][0], N_PHONEMEs, N_PHONEMEs, act.oP, f[oPiP_BLOCK]);
+			batch_spread(in.iM, &w->PiM[0][0], N_MORPHEMEs, N_PHONEMEs, act.iP, f[PiM_BLOCK]);
+
+			batch_update(act.C, in.C, N_CONCEPTs, keep[C_LAYER]);
+			batch_update(act.L, in.L, N_LEMMAs, keep[L_LAYER]);
+			batch_update(act.M, in.M, N_MORPHEMEs, keep[M_LAYER]);
+			batch_update(act.oP, in.oP, N_PHONEMEs, keep[oP_LAYER]);
+			batch_update(act.iP, in.iP, N_PHONEMEs, keep[iP_LAYER]);
+			batch_update(act.iM, in.iM, N_MORPHEMEs, keep[iM_LAYER]);
+			batch_update(act.S, in.S, N_SYLLABLEs, keep[S_LAYER]);
+
+			for (b = 0; b < BATCH; b++)
+				score[task][b] += (task == COMPREHENSION ? act.C[CAT][b] - act.C[DOG][b] 
+				                                         : act.S[CAT][b] - act.S[MAT][b]);
+		}
+
+		for (b = 0; b < BATCH; b++)
+			score[task][b] *= 100.0 / normal[task];
+	}
+}
+
+
+/* per network of the batch, the factor of each block and the retention of each layer */
+
+void batch_lesion_factors(const WEIGHT_SET *w, double lesion[N_GROUPs][BATCH], int weight_lesion, 
+	double f[N_BLOCKs][BATCH], double keep[N_LAYERs][BATCH])
+{
+	double d[N_LAYERs][BATCH];
+	int site, i, b;
+
+	for (b = 0; b < BATCH; b++) {
+		for (i = 0; i < N_BLOCKs; i++)
+			f[i][b] = 1.0;
+		for (i = 0; i < N_LAYERs; i++)
+			d[i][b] = 1.0;
+
+		for (site = NONFLUENT_AGRAMMATIC; site <= LOGOPENIC; site++) {
+			for (i = 0; i < N_BLOCKs; i++)
+				if (SITE_BLOCKS[site][i] && weight_lesion)
+					f[i][b] *= lesion[site][b];
+			for (i = 0; i < N_LAYERs; i++)
+				if (SITE_LAYERS[site][i] && !weight_lesion)
+					d[i][b] *= lesion[site][b];
+		}
+
+		for (i = 0; i < N_LAYERs; i++)
+			keep[i][b] = 1.0 - (w->config.rate[R_DECAY] * d[i][b]);
+	}
+}
+
+
+void simulate_populations()
+{
+	static long histogram[N_TASKs][N_SCORE_BINs];
+	char *name[N_GROUPs] = { "NORMAL", "NONFLUENT/AGRAMMATIC", "SEMANTIC DEMENTIA", "LOGOPENIC" };
+	double (*cases[N_GROUPs])[N_TASKs];
+	int n_cases[N_GROUPs];
+	double percentile[5] = { 0.05, 0.25, 0.50, 0.75, 0.95 };
+	WEIGHT_SET w;
+	double rate[N_RATEs], normal[N_TASKs], target, relative;
+	double sum[N_TASKs], sum_sq[N_TASKs], mean, sd, start;
+	long n_batches, batch, count;
+	int variant, t, i, k;
+
+	for (variant = NONFLUENT_AGRAMMATIC; variant <= LOGOPENIC; variant++)
+		n_cases[variant] = janssen_cases(variant, &cases[variant]);
+
+	for (i = 0; i < N_RATEs; i++)
+		rate[i] = *RATE_VARIABLE[i];
+	get_rate_configuration(&w.config, rate);
+	derive_weight_set(&w);
+	for (t = 0; t < N_TASKs; t++) {
+		run_fit_trial(&w, t, &target, &relative);
+		normal[t] = target - relative;
+	}
+
+	n_batches = (N_VIRTUAL_PATIENTs + BATCH - 1) / BATCH;
+
+	if (SAVE_PATIENTS && !start_result_writer(PATIENT_FILE))
+		return;
+
+	for (variant = NONFLUENT_AGRAMMATIC; variant <= LOGOPENIC; variant++) {
+
+		memset(histogram, 0, sizeof(histogram));
+		for (t = 0; t < N_TASKs; t++)
+			sum[t] = sum_sq[t] = 0.0;
+
+		start = wall_time();
+
+		#pragma omp parallel for schedule(dynamic, 16)
+		for (batch = 0; batch < n_batches; batch++) {
+			unsigned long long state = 0x5EED0000ULL * variant + batch;
+			PATIENT_RECORD r;
+			double (*score)[BATCH] = r.score, s1[N_TASKs], s2[N_TASKs];
+			int bins[N_TASKs][BATCH];
+			int task, b;
+
+			simulate_batch(&w, normal, variant, &state, r.lesion, score);
+			if (SAVE_PATIENTS) {
+				r.variant = variant;
+				r.batch = batch;
+				push_result(&r);
+			}
+
+			for (task = 0; task < N_TASKs; task++) {
+				s1[task] = s2[task] = 0.0;
+				for (b = 0; b < BATCH; b++) {
+					s1[task] += score[task][b];
+					s2[task] += score[task][b] * score[task][b];
+					bins[task][b] = SCORE_BIN(score[task][b]);
+				}
+			}
+
+			#pragma omp critical
+			for (task = 0; task < N_TASKs; task++) {
+				sum[task] += s1[task];
+				sum_sq[task] += s2[task];
+				for (b = 0; b < BATCH; b++)
+					histogram[task][bins[task][b]]++;
+			}
+		}
+
+		count = n_batches * BATCH;
+
+		printf("\nVIRTUAL POPULATION: %s, %ld patients (%.0f patients/s)\n", 
+			name[variant], count, count / (wall_time() - start));
+		printf("Lesion value %.2f (SD %.2f), other sites mixed in with SD %.2f\n", 
+			POP_MEAN[variant], POP_SD[variant], POP_MIX_SD[variant]);
+		printf("            Naming   Comprehension  Repetition \n");
+
+		printf("Sim mean: ");
+		for (t = 0; t < N_TASKs; t++)
+			printf("  %8.2f    ", sum[t] / count);
+		printf("\nSim SD:   ");
+		for (t = 0; t < N_TASKs; t++) {
+			mean = sum[t] / count;
+			sd = sum_sq[t] / count - mean * mean;
+			printf("  %8.2f    ", sd > 0.0 ? sqrt(sd) : 0.0);
+		}
+		for (k = 0; k < 5; k++) {
+			printf("\nSim P%-2.0f:  ", percentile[k] * 100.0);
+			for (t = 0; t < N_TASKs; t++) {
+				long c = 0;
+				for (i = 0; i < N_SCORE_BINs - 1; i++)
+					if ((c += histogram[t][i]) >= percentile[k] * count)
+						break;
+				printf("  %8.2f    ", i / 4.0 - 100.0 + 0.125);
+			}
+		}
+
+		/* Janssen et al. (2022) cases */
+		if (n_cases[variant] < 2) {
+			printf("\n(no real cases in %s)\n", STUDY_FILE);
+			continue;
+		}
+		printf("\nReal mean:");
+		for (t = 0; t < N_TASKs; t++) {
+			for (mean = 0.0, i = 0; i < n_cases[variant]; i++)
+				mean += cases[variant][i][t] / n_cases[variant];
+			printf("  %8.2f    ", mean);
+		}
+		printf("\nReal SD:  ");
+		for (t = 0; t < N_TASKs; t++) {
+			for (mean = 0.0, i = 0; i < n_cases[variant]; i++)
+				mean += cases[variant][i][t] / n_cases[variant];
+			for (sd = 0.0, i = 0; i < n_cases[variant]; i++)
+				sd += (cases[variant][i][t] - mean) * (cases[variant][i][t] - mean);
+			printf("  %8.2f    ", sqrt(sd / (n_cases[variant] - 1)));
+		}
+		printf("\n(real: Janssen et al., 2022, cases)\n");
+	}
+
+	if (SAVE_PATIENTS)
+		stop_result_writer();
+}
+
+
+
+
+/*************************
+ * MULTI-SITE LESION GRID *
+ *************************/
+
+/*
+   Sweep over all combinations of lesions at the three variant sites: the 
+   weight factors 1.00 - 0.01 (or with GRID_DECAY the decay factors 1.00 - 
+   1.66) of the nonfluent/agrammatic, semantic and logopenic sites, about 
+   10^6 configurations, in steps of LESION_STEP (0.01 by default). The grid is simulated one tile at a time, a tile 
+   being all semantic x logopenic combinations at one nonfluent/agrammatic 
+   value, in parallel batches with the batched engine of the virtual 
+   populations. Each tile is appended to GRID_FILE as soon as it is done, 
+   so memory stays at one tile and the file can be read while the sweep 
+   runs. The file holds a GRID_HEADER, followed per tile by its index and 
+   per configuration (semantic major) the three scores and the MAEs to the 
+   three patient groups of GRID_ASSESSMENT, as floats.
+*/
+
+#define N_GRID_FIELDs (N_TASKs + 3) /* scores and MAEs to the three patient groups */
+
+double grid_value(int i)
+{
+	return (GRID_DECAY ? 1.0 + LESION_STEP * i : 1.0 - LESION_STEP * i);
+}
+
+
+void sweep_lesion_grid()
+{
+	char *name[N_GROUPs] = { "normal", "nfa", "sem", "log" };
+	int n = (GRID_DECAY ? N_DECAY_PROFILEs + 1 : N_WEIGHT_PROFILEs), n_tile = n * n;
+	GRID_HEADER h;
+	WEIGHT_SET w;
+	double rate[N_RATEs], normal[N_TASKs], target, relative, start;
+	double best[N_GROUPs];
+	int best_at[N_GROUPs][3];
+	float *tile;
+	FILE *fp;
+	int i, j, g, t, b, n_batches;
+
+	assessment = GRID_ASSESSMENT;
+	set_real_data_matrix();
+
+	for (i = 0; i < N_RATEs; i++)
+		rate[i] = *RATE_VARIABLE[i];
+	get_rate_configuration(&w.config, rate);
+	derive_weight_set(&w);
+	for (t = 0; t < N_TASKs; t++) {
+		run_fit_trial(&w, t, &target, &relative);
+		normal[t] = target - relative;
+	}
+
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, "WPPGRID", 8);
+	h.n = n;
+	h.decay = GRID_DECAY;
+	h.assessment = GRID_ASSESSMENT;
+	h.n_fields = N_GRID_FIELDs;
+	h.first = grid_value(0);
+	h.step = grid_value(1) - grid_value(0);
+
+	if ((fp = fopen(GRID_FILE, "wb")) == NULL || (tile = malloc(sizeof(float) * n_tile * N_GRID_FIELDs)) == NULL) {
+		printf("\nCannot write %s\n", GRID_FILE);
+		if (fp != NULL)
+			fclose(fp);
+		return;
+	}
+	fwrite(&h, sizeof(h), 1, fp);
+	fflush(fp);
+
+	for (g = 0; g < N_GROUPs; g++)
+		best[g] = DBL_MAX;
+
+	printf("\nLESION GRID: %d x %d x %d %s factors, streaming to %s\n", 
+		n, n, n, GRID_DECAY ? "decay" : "weight", GRID_FILE);
+	start = wall_time();
+	n_batches = (n_tile + BATCH - 1) / BATCH;
+
+	for (i = 0; i < n; i++) {
+
+		#pragma omp parallel for schedule(dynamic)
+		for (b = 0; b < n_batches; b++) {
+			double lesion[N_GROUPs][BATCH], score[N_TASKs][BATCH];
+			int k, c, task, v;
+
+			for (k = 0; k < BATCH; k++) {
+				c = (b * BATCH + k < n_tile ? b * BATCH + k : n_tile - 1);
+				lesion[NONFLUENT_AGRAMMATIC][k] = grid_value(i);
+				lesion[SEMANTIC_DEMENTIA][k] = grid_value(c / n);
+				lesion[LOGOPENIC][k] = grid_value(c % n);
+			}
+
+			simulate_lesion_batch(&w, normal, lesion, !GRID_DECAY, score);
+
+			for (k = 0; k < BATCH && b * BATCH + k < n_tile; k++) {
+				float *out = &tile[(b * BATCH + k) * N_GRID_FIELDs];
+
+				for (task = 0; task < N_TASKs; task++)
+					out[task] = (float) score[task][k];
+				for (v = NONFLUENT_AGRAMMATIC; v <= LOGOPENIC; v++)
+					out[N_TASKs + v - 1] = (float) ((fabs(REAL_DATA[v][NAMING] - score[NAMING][k])
+						+ fabs(REAL_DATA[v][COMPREHENSION] - score[COMPREHENSION][k])
+						+ fabs(REAL_DATA[v][REPETITION] - score[REPETITION][k])) / 3.0);
+			}
+		}
+
+		fwrite(&i, sizeof(int), 1, fp);
+		fwrite(tile, sizeof(float), n_tile * N_GRID_FIELDs, fp);
+		fflush(fp);
+
+		for (j = 0; j < n_tile; j++)
+			for (g = NONFLUENT_AGRAMMATIC; g <= LOGOPENIC; g++)
+				if (tile[j * N_GRID_FIELDs + N_TASKs + g - 1] < best[g]) {
+					best[g] = tile[j * N_GRID_FIELDs + N_TASKs + g - 1];
+					best_at[g][0] = i;
+					best_at[g][1] = j / n;
+					best_at[g][2] = j % n;
+				}
+
+		if (i % 10 == 9 || i == n - 1) {
+			printf("tile %3d/%d (%.1f s), best MAE so far:", i + 1, n, wall_time() - start);
+			for (g = NONFLUENT_AGRAMMATIC; g <= LOGOPENIC; g++)
+				printf("  %s %.2f", name[g], best[g]);
+			printf("\n");
+			fflush(stdout);
+		}
+	}
+
+	fclose(fp);
+	free(tile);
+
+	printf("Best combinations for the data of assessment %d (nfa, sem, log %s factors):\n", 
+		GRID_ASSESSMENT, GRID_DECAY ? "decay" : "weight");
+	for (g = NONFLUENT_AGRAMMATIC; g <= LOGOPENIC; g++)
+		printf("%s: %.2f %.2f %.2f   MAE = %.2f\n", name[g], grid_value(best_at[g][0]), 
+			grid_value(best_at[g][1]), grid_value(best_at[g][2]), best[g]);
+	printf("%d configurations in %.1f s\n", n * n_tile, wall_time() - start);
+}
+
+
+
+
+/*************
+ * PRECISION *
+ *************/
+
+/*
+   The batched simulations in single precision (SINGLE_PRECISION), or with 
+   single-precision activations and weights but double-precision sums of 
+   the input of a step and of the scores over the steps (MIXED_PRECISION). 
+   Floats halve the memory of a batch and double the number of networks 
+   per vector instruction. Activations stay far within the range of a 
+   float, but the sums over a trial lose digits, which the mixed mode keeps. 
+   The trials of the regular fits stay in double precision and are the 
+   reference: PRECISION_REPORT compares the scores of all groups and lesion 
+   values of each precision with theirs, and the best-fit lesion values and 
+   MAEs of every assessment.
+*/
+
+void to_float(float *to, const double *from, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		to[i] = (float) from[i];
+}
+
+
+void get_float_weight_set(const WEIGHT_SET *w, FLOAT_WEIGHT_SET *fw)
+{
+	to_float(&fw->CC[0][0], &w->CC[0][0], N_CONCEPTs * N_CONCEPTs);
+	to_float(&fw->LC[0][0], &w->LC[0][0], N_CONCEPTs * N_LEMMAs);
+	to_float(&fw->CL[0][0], &w->CL[0][0], N_LEMMAs * N_CONCEPTs);
+	to_float(&fw->iML[0][0], &w->iML[0][0], N_LEMMAs * N_MORPHEMEs);
+	to_float(&fw->LM[0][0], &w->LM[0][0], N_MORPHEMEs * N_LEMMAs);
+	to_float(&fw->iMM[0][0], &w->iMM[0][0], N_MORPHEMEs * N_MORPHEMEs);
+	to_float(&fw->MP[0][0], &w->MP[0][0], N_PHONEMEs * N_MORPHEMEs);
+	to_float(&fw->iPoP[0][0], &w->iPoP[0][0], N_PHONEMEs * N_PHONEMEs);
+	to_float(&fw->PS[0][0], &w->PS[0][0], N_SYLLABLEs * N_PHONEMEs);
+	to_float(&fw->oPiP[0][0], &w->oPiP[0][0], N_PHONEMEs * N_PHONEMEs);
+	to_float(&fw->PiM[0][0], &w->PiM[0][0], N_MORPHEMEs * N_PHONEMEs);
+}
+
+
+/* batch_spread() and batch_update() with float sums, and with double sums */
+
+void float_batch_spread(float (*in)[BATCH], const float *weight, int n_to, int n_from, 
+	float (*from)[BATCH], const float *factor)
+{
+	float sum[BATCH], wij;
+	int i, j, b;
+
+	for (i = 0; i < n_to; i++) {
+		for (b = 0; b < BATCH; b++)
+			sum[b] = 0.0f;
+		for (j = 0; j < n_from; j++) {
+			wij = weight[i * n_from + j];
+			if (wij == 0.0f)
+				continue;
+			for (b = 0; b < BATCH; b++)
+				sum[b] += wij * from[j][b];
+		}
+		for (b = 0; b < BATCH; b++)
+			in[i][b] += factor[b] * sum[b];
+	}
+}
+
+
+void mixed_batch_spread(double (*in)[BATCH], const float *weight, int n_to, int n_from, 
+	float (*from)[BATCH], const float *factor)
+{
+	double sum[BATCH], wij;
+	int i, j, b;
+
+	for (i = 0; i < n_to; i++) {
+		for (b = 0; b < BATCH; b++)
+			sum[b] = 0.0;
+		for (j = 0; j < n_from; j++) {
+			wij = weight[i * n_from + j];
+			if (wij == 0.0)
+				continue;
+			for (b = 0; b < BATCH; b++)
+				sum[b] += wij * from[j][b];
+		}
+		for (b = 0; b < BATCH; b++)
+			in[i][b] += factor[b] * sum[b];
+	}
+}
+
+
+void float_batch_update(float (*act)[BATCH], float (*in)[BATCH], int n, const float *keep)
+{
+	int i, b;
+
+	for (i = 0; i < n; i++)
+		for (b = 0; b < BATCH; b++)
+			act[i][b] = act[i][b] * keep[b] + in[i][b];
+}
+
+
+void mixed_batch_update(float (*act)[BATCH], double (*in)[BATCH], int n, const float *keep)
+{
+	int i, b;
+
+	for (i = 0; i < n; i++)
+		for (b = 0; b < BATCH; b++)
+			act[i][b] = (float) (act[i][b] * keep[b] + in[i][b]);
+}
+
+
+/* simulate_lesion_batch() in single or mixed precision */
+
+void simulate_lesion_batch_float(const WEIGHT_SET *w, const double normal[N_TASKs], 
+	double lesion[N_GROUPs][BATCH], int weight_lesion, int mixed, double score[N_TASKs][BATCH])
+{
+	static FLOAT_BATCH_LAYERS act, in;
+	static BATCH_LAYERS sum;
+	static FLOAT_WEIGHT_SET fw;
+	#pragma omp threadprivate(act, in, sum, fw)
+	double f[N_BLOCKs][BATCH], keep[N_LAYERs][BATCH];
+	float ff[N_BLOCKs][BATCH], fkeep[N_LAYERs][BATCH], fscore[BATCH];
+	float picture_input = (float) w->picture_input, extin = (float) w->extin;
+	int i, b, task, s;
+
+	batch_lesion_factors(w, lesion, weight_lesion, f, keep);
+	to_float(&ff[0][0], &f[0][0], N_BLOCKs * BATCH);
+	to_float(&fkeep[0][0], &keep[0][0], N_LAYERs * BATCH);
+	get_float_weight_set(w, &fw);
+
+	for (task = 0; task < N_TASKs; task++) {
+
+		memset(&act, 0, sizeof(act));
+		for (b = 0; b < BATCH; b++) {
+			score[task][b] = 0.0;
+			fscore[b] = 0.0f;
+		}
+
+		for (s = 0; s < N_STEPs; s++) {
+			memset(&in, 0, sizeof(in));
+
+			/* external input, as in simulate_lesion_batch() */
+			if (task == NAMING) {
+				if (s * STEP_SIZE < PICTURE_DURATION)
+					for (b = 0; b < BATCH; b++)
+						in.C[CAT][b] += picture_input * ff[PICTURE_BLOCK][b];
+				if (s * STEP_SIZE >= CYCLE_TIME && s * STEP_SIZE < CYCLE_TIME + PICTURE_DURATION)
+					for (b = 0; b < BATCH; b++)
+						in.C[CAT][b] += extin;
+			}
+			else {
+				i = (s * STEP_SIZE < SEGMENT_DURATION ? pK 
+				     : s * STEP_SIZE < 2 * SEGMENT_DURATION ? pE 
+				     : s * STEP_SIZE < 3 * SEGMENT_DURATION ? pT : -1);
+				if (i >= 0)
+					for (b = 0; b < BATCH; b++)
+						in.iP[i][b] += extin;
+			}
+
+			if (mixed) {
+				/* the external input as above, the internal input summed in double */
+				for (i = 0; i < N_CONCEPTs; i++)
+					for (b = 0; b < BATCH; b++)
+						sum.C[i][b] = in.C[i][b];
+				for (i = 0; i < N_PHONEMEs; i++)
+					for (b = 0; b < BATCH; b++)
+						sum.iP[i][b] = in.iP[i][b];
+				memset(sum.L, 0, sizeof(sum.L));
+				memset(sum.M, 0, sizeof(sum.M));
+				memset(sum.oP, 0, sizeof(sum.oP));
+				memset(sum.S, 0, sizeof(sum.S));
+				memset(sum.iM, 0, sizeof(sum.iM));
+
+				mixed_batch_spread(sum.C, &fw.CC[0][0], N_CONCEPTs, N_CONCEPTs, act.C, ff[CC_BLOCK]);
+				mixed_batch_spread(sum.C, &fw.LC[0][0], N_CONCEPTs, N_LEMMAs, act.L, ff[LC_BLOCK]);
+				mixed_batch_spread(sum.L, &fw.CL[0][0], N_LEMMAs, N_CONCEPTs, act.C, ff[CL_BLOCK]);
+				mixed_batch_spread(sum.L, &fw.iML[0][0], N_LEMMAs, N_MORPHEMEs, act.iM, ff[iML_BLOCK]);
+				mixed_batch_spread(sum.M, &fw.LM[0][0], N_MORPHEMEs, N_LEMMAs, act.L, ff[LM_BLOCK]);
+				mixed_batch_spread(sum.M, &fw.iMM[0][0], N_MORPHEMEs, N_MORPHEMEs, act.iM, ff[iMM_BLOCK]);
+				mixed_batch_spread(sum.oP, &fw.MP[0][0], N_PHONEMEs, N_MORPHEMEs, act.M, ff[MP_BLOCK]);
+				mixed_batch_spread(sum.oP, &fw.iPoP[0][0], N_PHONEMEs, N_PHONEMEs, act.iP, ff[iPoP_BLOCK]);
+				mixed_batch_spread(sum.S, &fw.PS[0][0], N_SYLLABLEs, N_PHONEMEs, act.oP, ff[PS_BLOCK]);
+				mixed_batch_spread(sum.iP, &fw.oPiP[0][0], N_PHONEMEs, N_PHONEMEs, act.oP, ff[oPiP_BLOCK]);
+				mixed_batch_spread(sum.iM, &fw.PiM[0][0], N_MORPHEMEs, N_PHONEMEs, act.iP, ff[PiM_BLOCK]);
+
+				mixed_batch_update(act.C, sum.C, N_CONCEPTs, fkeep[C_LAYER]);
+				mixed_batch_update(act.L, sum.L, N_LEMMAs, fkeep[L_LAYER]);
+				mixed_batch_update(act.M, sum.M, N_MORPHEMEs, fkeep[M_LAYER]);
+				mixed_batch_update(act.oP, sum.oP, N_PHONEMEs, fkeep[oP_LAYER]);
+				mixed_batch_update(act.iP, sum.iP, N_PHONEMEs, fkeep[iP_LAYER]);
+				mixed_batch_update(act.iM, sum.iM, N_MORPHEMEs, fkeep[iM_LAYER]);
+				mixed_batch_update(act.S, sum.S, N_SYLLABLEs, fkeep[S_LAYER]);
+
+				for (b = 0; b < BATCH; b++)
+					score[task][b] += (task == COMPREHENSION ? (double) act.C[CAT][b] - act.C[DOG][b] 
+					                                         : (double) act.S[CAT][b] - act.S[MAT][b]);
+			}
+			else {
+				float_batch_spread(in.C, &fw.CC[0][0], N_CONCEPTs, N_CONCEPTs, act.C, ff[CC_BLOCK]);
+				float_batch_spread(in.C, &fw.LC[0][0], N_CONCEPTs, N_LEMMAs, act.L, ff[LC_BLOCK]);
+				float_batch_spread(in.L, &fw.CL[0][0], N_LEMMAs, N_CONCEPTs, act.C, ff[CL_BLOCK]);
+				float_batch_spread(in.L, &fw.iML[0][0], N_LEMMAs, N_MORPHEMEs, act.iM, ff[iML_BLOCK]);
+				float_batch_spread(in.M, &fw.LM[0][0], N_MORPHEMEs, N_LEMMAs, act.L, ff[LM_BLOCK]);
+				float_batch_spread(in.M, &fw.iMM[0][0], N_MORPHEMEs, N_MORPHEMEs, act.iM, ff[iMM_BLOCK]);
+				float_batch_spread(in.oP, &fw.MP[0][0], N_PHONEMEs, N_MORPHEMEs, act.M, ff[MP_BLOCK]);
+				float_batch_spread(in.oP, &fw.iPoP[0][0], N_PHONEMEs, N_PHONEMEs, act.iP, ff[iPoP_BLOCK]);
+				float_batch_spread(in.S, &fw.PS[0][0], N_SYLLABLEs, N_PHONEMEs, act.oP, ff[PS_BLOCK]);
+				float_batch_spread(in.iP, &fw.oPiP[0][0], N_PHONEMEs, N_PHONEMEs, act.oP, ff[oPiP_BLOCK]);
+				float_batch_spread(in.iM, &fw.PiM[0][0], N_MORPHEMEs, N_PHONEMEs, act.iP, ff[PiM_BLOCK]);
+
+				float_batch_update(act.C, in.C, N_CONCEPTs, fkeep[C_LAYER]);
+				float_batch_update(act.L, in.L, N_LEMMAs, fkeep[L_LAYER]);
+				float_batch_update(act.M, in.M, N_MORPHEMEs, fkeep[M_LAYER]);
+				float_batch_update(act.oP, in.oP, N_PHONEMEs, fkeep[oP_LAYER]);
+				float_batch_update(act.iP, in.iP, N_PHONEMEs, fkeep[iP_LAYER]);
+				float_batch_update(act.iM, in.iM, N_MORPHEMEs, fkeep[iM_LAYER]);
+				float_batch_update(act.S, in.S, N_SYLLABLEs, fkeep[S_LAYER]);
+
+				for (b = 0; b < BATCH; b++)
+					fscore[b] += (task == COMPREHENSION ? act.C[CAT][b] - act.C[DOG][b] 
+					                                    : act.S[CAT][b] - act.S[MAT][b]);
+			}
+		}
+
+		for (b = 0; b < BATCH; b++)
+			score[task][b] = (mixed ? score[task][b] : fscore[b]) * 100.0 / normal[task];
+	}
+}
+
+
+/* scores of every group at every lesion value, in batches of the current PRECISION */
+
+void batch_scores(const WEIGHT_SET *w, const double normal[N_TASKs], double (*score)[N_GROUPs][N_TASKs])
+{
+	int n = N_GROUPs * N_lesion_values, n_batches = (n + BATCH - 1) / BATCH, b;
+
+	#pragma omp parallel for schedule(dynamic)
+	for (b = 0; b < n_batches; b++) {
+		double lesion[N_GROUPs][BATCH], batch_score[N_TASKs][BATCH];
+		int k, c, site, t;
+
+		for (k = 0; k < BATCH; k++) {
+			c = (b * BATCH + k < n ? b * BATCH + k : n - 1);
+			for (site = 0; site < N_GROUPs; site++)
+				lesion[site][k] = (site != c / N_lesion_values ? 1.0 : WEIGHT_LESION 
+				                   ? WEIGHT_value[c % N_lesion_values] : DECAY_value[c % N_lesion_values]);
+		}
+
+		simulate_lesion_batch(w, normal, lesion, WEIGHT_LESION, batch_score);
+
+		for (k = 0; k < BATCH && b * BATCH + k < n; k++)
+			for (t = 0; t < N_TASKs; t++)
+				score[(b * BATCH + k) % N_lesion_values][(b * BATCH + k) / N_lesion_values][t] = batch_score[t][k];
+	}
+}
+
+
+/* best-fit lesion value and its MAE per group, for the data of assessment a */
+
+void best_fits(double (*score)[N_GROUPs][N_TASKs], int a, int best[N_GROUPs], double mae[N_GROUPs])
+{
+	double error;
+	int g, lv, t;
+
+	assessment = a;
+	set_real_data_matrix();
+
+	for (g = 0; g < N_GROUPs; g++)
+		for (best[g] = 0, mae[g] = DBL_MAX, lv = 0; lv < N_lesion_values; lv++) {
+			for (error = 0.0, t = 0; t < N_TASKs; t++)
+				error += fabs(REAL_DATA[g][t] - score[lv][g][t]);
+			if (error / 3.0 < mae[g]) {
+				mae[g] = error / 3.0;
+				best[g] = lv;
+			}
+		}
+}
+
+
+void report_precision()
+{
+	char *name[N_PRECISIONs] = { "double", "single", "mixed" };
+	double (*reference)[N_GROUPs][N_TASKs] = malloc(sizeof(*reference) * N_lesion_values);
+	double (*score)[N_GROUPs][N_TASKs] = malloc(sizeof(*score) * N_lesion_values);
+	double *value = (WEIGHT_LESION ? WEIGHT_value : DECAY_value);
+	double rate[N_RATEs], normal[N_TASKs], target, relative, start, seconds;
+	double score_diff, value_diff, mae_diff, mae[N_GROUPs], ref_mae[N_ASSESSMENTs][N_GROUPs];
+	int best[N_GROUPs], ref_best[N_ASSESSMENTs][N_GROUPs];
+	int p, a, g, lv, t, n_changed, saved_precision = PRECISION;
+	WEIGHT_SET w;
+
+	if (reference == NULL || score == NULL) {
+		printf("\nNot enough memory for the precision report\n");
+		free(reference);
+		free(score);
+		return;
+	}
+
+	for (t = 0; t < N_RATEs; t++)
+		rate[t] = *RATE_VARIABLE[t];
+	get_rate_configuration(&w.config, rate);
+	derive_weight_set(&w);
+	for (t = 0; t < N_TASKs; t++) {
+		run_fit_trial(&w, t, &target, &relative);
+		normal[t] = target - relative;
+	}
+
+	/* the reference: the trials of the regular fits */
+	for (g = 0; g < N_GROUPs; g++)
+		for (lv = 0; lv < N_lesion_values; lv++) {
+			WEIGHT_SET wl;
+
+			get_rate_configuration(&wl.config, rate);
+			if (g != NORMAL)
+				add_lesion(&wl.config, g, WEIGHT_LESION ? WEIGHT_value[lv] : 1.0, 
+				                          DECAY_LESION ? DECAY_value[lv] : 1.0);
+			derive_weight_set(&wl);
+			for (t = 0; t < N_TASKs; t++) {
+				run_fit_trial(&wl, t, &target, &relative);
+				reference[lv][g][t] = (target - relative) / normal[t] * 100.0;
+			}
+		}
+	for (a = 0; a < N_ASSESSMENTs; a++)
+		best_fits(reference, a, ref_best[a], ref_mae[a]);
+
+	printf("\nPRECISION of the batched simulations, against the double-precision trials\n");
+	printf("(largest differences over all groups, lesion values and assessments)\n");
+	printf("           scores     best fits changed   value    MAE        time\n");
+
+	for (p = 0; p < N_PRECISIONs; p++) {
+		PRECISION = p;
+		start = wall_time();
+		batch_scores(&w, normal, score);
+		seconds = wall_time() - start;
+
+		for (score_diff = 0.0, lv = 0; lv < N_lesion_values; lv++)
+			for (g = 0; g < N_GROUPs; g++)
+				for (t = 0; t < N_TASKs; t++)
+					if (fabs(score[lv][g][t] - reference[lv][g][t]) > score_diff)
+						score_diff = fabs(score[lv][g][t] - reference[lv][g][t]);
+
+		for (n_changed = 0, value_diff = 0.0, mae_diff = 0.0, a = 0; a < N_ASSESSMENTs; a++) {
+			best_fits(score, a, best, mae);
+			for (g = NORMAL + 1; g < N_GROUPs; g++) {
+				if (best[g] != ref_best[a][g])
+					n_changed++;
+				if (fabs(value[best[g]] - value[ref_best[a][g]]) > value_diff)
+					value_diff = fabs(value[best[g]] - value[ref_best[a][g]]);
+				if (fabs(mae[g] - ref_mae[a][g]) > mae_diff)
+					mae_diff = fabs(mae[g] - ref_mae[a][g]);
+			}
+		}
+
+		printf("%-8s   %.2e   %2d of %-2d            %.2f     %.2e   %.4f s\n", name[p], score_diff, 
+			n_changed, N_ASSESSMENTs * (N_GROUPs - 1), value_diff, mae_diff, seconds);
+	}
+
+	PRECISION = saved_precision;
+	free(reference);
+	free(score);
+}
+
+
+
+
+/***************
+ * STATE ARENA *
+ ***************/
+
+/*
+   The tensors over lesion values and steps are sized to the run: 
+   allocate_state() first only measures them, then takes one zeroed block 
+   for all of them, each tensor aligned to 64 bytes, and never frees it.
+*/
+
+ARENA STATE_ARENA;
+
+
+/* the next size bytes of the arena; while measuring (no base yet), NULL */
+
+void *arena_alloc(ARENA *a, size_t size)
+{
+	void *p = (a->base == NULL ? NULL : a->base + a->used);
+
+	a->used += (size + 63) & ~(size_t) 63;
+	return p;
+}
+
+
+#define ARENA_TENSOR(x, n) ((x) = arena_alloc(a, sizeof(*(x)) * (n)))
+
+void allocate_state_tensors(ARENA *a)
+{
+	size_t nl = N_lesion_values, ns = N_STEPs;
+
+	ARENA_TENSOR(GOODNESS_OF_FIT, nl);
+	ARENA_TENSOR(WEIGHT_value, nl);
+	ARENA_TENSOR(DECAY_value, nl);
+
+	ARENA_TENSOR(TRAJECTORY, nl * N_GROUPs * N_TASKs * N_PROBEs * ns);
+	ARENA_TENSOR(PROPAGATOR_CACHE, EXPONENTIAL_INTEGRATION ? N_WEIGHT_SETs : 0);
+	ARENA_TENSOR(PROBE_RECORD, nl * N_GROUPs * N_TASKs * PROBE_RECORD_SIZE);
+
+	ARENA_TENSOR(TOTAL_ACT_C, nl);
+	ARENA_TENSOR(MEAN_ACT_C, nl);
+	ARENA_TENSOR(TOTAL_ACT_S, nl);
+	ARENA_TENSOR(MEAN_ACT_S, nl);
+	ARENA_TENSOR(TOTAL_ACT_CT, nl);
+	ARENA_TENSOR(MEAN_ACT_CT, nl);
+	ARENA_TENSOR(TOTAL_ACT_CR, nl);
+	ARENA_TENSOR(MEAN_ACT_CR, nl);
+	ARENA_TENSOR(TOTAL_ACT_LT, nl);
+	ARENA_TENSOR(MEAN_ACT_LT, nl);
+	ARENA_TENSOR(TOTAL_ACT_LR, nl);
+	ARENA_TENSOR(MEAN_ACT_LR, nl);
+	ARENA_TENSOR(TOTAL_ACT_ST, nl);
+	ARENA_TENSOR(MEAN_ACT_ST, nl);
+	ARENA_TENSOR(TOTAL_ACT_SR, nl);
+	ARENA_TENSOR(MEAN_ACT_SR, nl);
+
+	ARENA_TENSOR(TOTAL_ACT_TYPE, nl);
+	ARENA_TENSOR(MEAN_ACT_TYPE, nl);
+
+	ARENA_TENSOR(P_SELECT_TARGET, nl);
+	ARENA_TENSOR(P_SELECT_TYPE, nl);
+	ARENA_TENSOR(P_NO_RESPONSE, nl);
+	ARENA_TENSOR(RESPONSE_LATENCY, nl);
+
+	ARENA_TENSOR(D_MEAN_ACT_CT, nl);
+	ARENA_TENSOR(D_MEAN_ACT_CR, nl);
+	ARENA_TENSOR(D_MEAN_ACT_ST, nl);
+	ARENA_TENSOR(D_MEAN_ACT_SR, nl);
+	ARENA_TENSOR(TANGENT_CACHE, SHOW_SENSITIVITIES ? N_WEIGHT_SETs : 0);
+
+	ARENA_TENSOR(SCORE_TABLE, nl);
+
+	ARENA_TENSOR(PROFILES, CLASSIFY_CASES ? N_PROFILEs : 0);
+	ARENA_TENSOR(PROFILE_ORDER, CLASSIFY_CASES ? N_PROFILEs : 0);
+}
+
+
+void allocate_state()
+{
+	STATE_ARENA.base = NULL;
+	STATE_ARENA.used = 0;
+	allocate_state_tensors(&STATE_ARENA);
+
+	STATE_ARENA.size = STATE_ARENA.used;
+#ifdef _WIN32
+	STATE_ARENA.base = _aligned_malloc(STATE_ARENA.size, 64);
+#else
+	if (posix_memalign((void **) &STATE_ARENA.base, 64, STATE_ARENA.size) != 0)
+		STATE_ARENA.base = NULL;
+#endif
+	if (STATE_ARENA.base == NULL) {
+		fprintf(stderr, "Cannot allocate %.1f MB for %d lesion values and %d steps\n", 
+			STATE_ARENA.size / 1048576.0, N_lesion_values, N_STEPs);
+		exit(1);
+	}
+	memset(STATE_ARENA.base, 0, STATE_ARENA.size);
+	STATE_ARENA.used = 0;
+	allocate_state_tensors(&STATE_ARENA);
+}
+
+
+
+
+/*********************
+ * FITS AND PRINTING *
+ *********************/
+
+ void print_heading()
+ {
+	 printf("\n");
+	 printf("WEAVER++/ARC model simulation of primary progressive aphasia (c) Ardi Roelofs\n");
+	 printf("Simulation of group studies \n");
+
+ }
+
+
+ void print_parameters()
+ {
+	 
+
+     printf("Parameter values:\n");
+     printf("cycle time : %6d [ms]\n", CYCLE_TIME);
+     printf("sem_rate   : %.4f [prop/ms]\n",SEM_rate/STEP_SIZE);
+     printf("lem_rate   : %.4f [prop/ms]\n",LEM_rate/STEP_SIZE);
      printf("exin       : %.4f [act_units/ms]\n",EXTIN/STEP_SIZE);
      printf("d          : %.4f [prop/ms]\n",DECAY_rate/STEP_SIZE);
 
@@ -993,6 +6684,9 @@ void compute_activation_results()
 	 for (i = 0; i < N_lesion_values; i++)
 		 GOODNESS_OF_FIT[i] = 0.0;
 
+	 if (BOOTSTRAP || PROGRESSION)
+		 compute_score_table();
+
 	 if (assessment == ENGLISH)
 		 printf("\nAssessment is Savage et al. (2013), English\n");
 	 if (assessment == DUTCH)
@@ -1104,11 +6798,159 @@ void compute_activation_results()
 				/ (MEAN_ACT_ST[a][NORMAL][REPETITION]
 					- MEAN_ACT_SR[a][NORMAL][REPETITION]) * 100.0);
 
+		if (SHOW_ERROR_TYPES)
+			print_error_type_distribution(a);
+
+		if (SHOW_LUCE_RESULTS)
+			print_luce_results(a);
+
+		if (SHOW_TRAJECTORY_METRICS && !MEAN_ONLY)
+			print_trajectory_metrics(a);
+
+		if (SHOW_SENSITIVITIES)
+			print_sensitivities(a);
+
+		if (BOOTSTRAP && group != NORMAL)
+			print_bootstrap_interval();
+
+		if (PROGRESSION && group != NORMAL 
+			&& (assessment == BRAMBATI_T2 || assessment == ROHRERMANDELLI_T2))
+			print_progression();
 
    }
  }
 
 
+ /* d(score)/d(parameter) at lesion value a, rates per ms as in print_parameters() */
+
+ void print_sensitivities(int a)
+ {
+	 char *name[N_SENS_PARAMs] = { "sem_rate", "lem_rate", "lex_rate", "d", "exin", 
+	                               "lemlexfrac", "fr", "lesion" };
+	 double per_ms[N_SENS_PARAMs] = { STEP_SIZE, STEP_SIZE, STEP_SIZE, STEP_SIZE, STEP_SIZE, 
+	                                  1.0, 1.0, 1.0 };
+	 double t, r, tn, rn, dt, dr, dtn, drn;
+	 int p, k;
+
+	 printf("d Sim / d     Naming   Comprehension  Repetition \n");
+	 for (p = 0; p < N_SENS_PARAMs; p++) {
+		 printf("%-10s", name[p]);
+		 for (k = 0; k < N_TASKs; k++) {
+			 if (k == COMPREHENSION) {
+				 t = MEAN_ACT_CT[a][group][k];   dt = D_MEAN_ACT_CT[a][group][k][p];
+				 r = MEAN_ACT_CR[a][group][k];   dr = D_MEAN_ACT_CR[a][group][k][p];
+				 tn = MEAN_ACT_CT[a][NORMAL][k]; dtn = D_MEAN_ACT_CT[a][NORMAL][k][p];
+				 rn = MEAN_ACT_CR[a][NORMAL][k]; drn = D_MEAN_ACT_CR[a][NORMAL][k][p];
+			 }
+			 else {
+				 t = MEAN_ACT_ST[a][group][k];   dt = D_MEAN_ACT_ST[a][group][k][p];
+				 r = MEAN_ACT_SR[a][group][k];   dr = D_MEAN_ACT_SR[a][group][k][p];
+				 tn = MEAN_ACT_ST[a][NORMAL][k]; dtn = D_MEAN_ACT_ST[a][NORMAL][k][p];
+				 rn = MEAN_ACT_SR[a][NORMAL][k]; drn = D_MEAN_ACT_SR[a][NORMAL][k][p];
+			 }
+			 /* quotient rule on (t - r) / (tn - rn) * 100 */
+			 printf("  %10.2f", ((dt - dr) * (tn - rn) - (t - r) * (dtn - drn)) 
+			                    / ((tn - rn) * (tn - rn)) * 100.0 * per_ms[p]);
+		 }
+		 printf("\n");
+	 }
+ }
+
+
+ /* Accuracy (given a response, and relative to NORMAL), latency and 
+    errors per type from Luce-ratio selection, for lesion value a */
+
+ void print_luce_results(int a)
+ {
+	 double responded, normal_responded, accuracy, normal_accuracy;
+	 int type;
+
+	 printf("Luce:   Accuracy  Rel.Acc  Latency  No resp.  Sem   Phon  Mixed  Unrel [%%, ms]\n");
+
+	 for (task = 0; task < N_TASKs; task++) {
+
+		 responded = 1.0 - P_NO_RESPONSE[a][group][task];
+		 normal_responded = 1.0 - P_NO_RESPONSE[a][NORMAL][task];
+
+		 accuracy = (responded > 0.0 ? 
+			 P_SELECT_TARGET[a][group][task] / responded * 100.0 : 0.0);
+		 normal_accuracy = (normal_responded > 0.0 ? 
+			 P_SELECT_TARGET[a][NORMAL][task] / normal_responded * 100.0 : 0.0);
+
+		 if (task == NAMING)
+			 printf("  Nam: ");
+		 else if (task == COMPREHENSION)
+			 printf("  Com: ");
+		 else
+			 printf("  Rep: ");
+
+		 printf("  %6.2f   %6.2f   %7.1f   %6.2f ", accuracy,
+			 normal_accuracy > 0.0 ? accuracy / normal_accuracy * 100.0 : 0.0,
+			 RESPONSE_LATENCY[a][group][task], P_NO_RESPONSE[a][group][task] * 100.0);
+
+		 for (type = 0; type < N_ERROR_TYPEs; type++)
+			 printf(" %5.2f", responded > 0.0 ? 
+				 P_SELECT_TYPE[a][group][task][type] / responded * 100.0 : 0.0);
+		 printf("\n");
+	 }
+ }
+
+
+ void print_competitor_sets()
+ {
+	 char *level_name[N_LEVELs] = { "Concepts ", "Lemmas   ", "Syllables" };
+	 char *type_name[N_ERROR_TYPEs] = { "semantic", "phonological", "mixed", "unrelated" };
+	 int level, type, i;
+
+	 printf("\nCompetitors of target word %d derived from the network:\n", TARGET_WORD);
+
+	 for (level = 0; level < N_LEVELs; level++) {
+		 printf("%s  target %2d ", level_name[level], TARGET_NODE[level]);
+		 for (type = 0; type < N_ERROR_TYPEs; type++) {
+			 printf("  %s {", type_name[type]);
+			 for (i = 0; i < N_MAX_LEVEL_NODEs; i++)
+				 if (COMPETITOR_MASK[level][type][i] != 0.0)
+					 printf(" %d", i);
+			 printf(" }");
+		 }
+		 printf("\n");
+	 }
+ }
+
+
+ /* Error-type distribution at the response level of each task, for the best
+    fitting lesion value a: share of the competitor activation per type */
+
+ void print_error_type_distribution(int a)
+ {
+	 double mass[N_ERROR_TYPEs], total;
+	 int type;
+
+	 printf("Errors: Semantic  Phonological  Mixed  Unrelated [%%]\n");
+
+	 for (task = 0; task < N_TASKs; task++) {
+
+		 for (type = 0, total = 0.0; type < N_ERROR_TYPEs; type++) {
+			 mass[type] = MEAN_ACT_TYPE[a][group][task][RESPONSE_LEVEL[task]][type];
+			 if (mass[type] < 0.0)
+				 mass[type] = 0.0;
+			 total += mass[type];
+		 }
+
+		 if (task == NAMING)
+			 printf("  Nam: ");
+		 else if (task == COMPREHENSION)
+			 printf("  Com: ");
+		 else
+			 printf("  Rep: ");
+
+		 for (type = 0; type < N_ERROR_TYPEs; type++)
+			 printf("  %6.2f   ", total > 0.0 ? mass[type] / total * 100.0 : 0.0);
+		 printf("\n");
+	 }
+ }
+
+
 
 
  
\ No newline at end of file